@@ -0,0 +1,138 @@
+// Synthetic workload generator for simcpu, writes an input file in the format described in README.md
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+typedef enum {
+    DIST_CONST, DIST_UNIFORM, DIST_EXP
+} distType;
+
+typedef struct {
+    distType type;
+    int lo; // Constant value, or lower bound of a uniform distribution
+    int hi; // Upper bound of a uniform distribution
+    double mean; // Mean of an exponential distribution
+} distribution;
+
+unsigned long long rngState = 1; // xorshift64* state, same sequence on every platform for a given seed
+
+unsigned long long nextRandom();
+int uniform(int lo, int hi);
+int sample(distribution* d);
+bool parseDistribution(char* arg, distribution* d);
+
+int main(int argc, char* argv[]) {
+    int processAmt = 10;
+    distribution threads = { DIST_UNIFORM, 1, 50, 0 };
+    distribution bursts = { DIST_UNIFORM, 1, 10, 0 };
+    distribution cpu = { DIST_UNIFORM, 1, 100, 0 };
+    distribution io = { DIST_UNIFORM, 1, 100, 0 };
+    int maxArrival = 1000;
+    int threadSwitch = 3;
+    int processSwitch = 7;
+    bool sorted = false;
+    bool valid = true;
+
+    /* Parse Input Parameters */
+    for(int i = 1; i < argc && valid; i++) {
+        if(strcmp(argv[i], "-p") == 0 && i + 1 < argc) // -p flag was presented
+            valid = (processAmt = atoi(argv[++i])) > 0;
+        else if(strcmp(argv[i], "-t") == 0 && i + 1 < argc) // -t flag was presented
+            valid = parseDistribution(argv[++i], &threads) && threads.type != DIST_EXP;
+        else if(strcmp(argv[i], "-b") == 0 && i + 1 < argc) // -b flag was presented
+            valid = parseDistribution(argv[++i], &bursts) && bursts.type != DIST_EXP;
+        else if(strcmp(argv[i], "--cpu") == 0 && i + 1 < argc) // --cpu flag was presented
+            valid = parseDistribution(argv[++i], &cpu);
+        else if(strcmp(argv[i], "--io") == 0 && i + 1 < argc) // --io flag was presented
+            valid = parseDistribution(argv[++i], &io);
+        else if(strcmp(argv[i], "-a") == 0 && i + 1 < argc) // -a flag was presented
+            valid = (maxArrival = atoi(argv[++i])) >= 0;
+        else if(strcmp(argv[i], "--switch") == 0 && i + 1 < argc) // --switch flag was presented
+            valid = sscanf(argv[++i], "%d,%d", &threadSwitch, &processSwitch) == 2 && threadSwitch >= 0 && processSwitch >= 0;
+        else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) // -s flag was presented
+            rngState = strtoull(argv[++i], NULL, 10) * 2685821657736338717ULL + 1; // Any seed, including 0, gives a nonzero state
+        else if(strcmp(argv[i], "--sorted") == 0) // --sorted flag was presented
+            sorted = true;
+        else
+            valid = false;
+    }
+    if(!valid || threads.lo <= 0 || bursts.lo <= 0) {
+        fprintf(stderr, "Usage: simcpu-gen [-p processes] [-t threads] [-b bursts] [--cpu dist] [--io dist] [-a max_arrival] [--switch thread,process] [-s seed] [--sorted]\n");
+        fprintf(stderr, "threads and bursts are N or LO-HI, dist is N, LO-HI, or exp:MEAN. Threads and bursts must be positive.\n");
+        return 1;
+    }
+
+    /* Write Workload */
+    static char outBuf[1 << 20];
+    setvbuf(stdout, outBuf, _IOFBF, sizeof(outBuf));
+    int arrival = 0;
+    long long expectedThreads = (long long)processAmt * (threads.lo + threads.hi) / 2 + 1;
+    int arrivalStep = (int)(2LL * maxArrival / expectedThreads); // Sorted arrivals climb by half this on average, ending near maxArrival
+    printf("%d %d %d\n", processAmt, threadSwitch, processSwitch);
+    for(int p = 1; p <= processAmt; p++) {
+        int threadAmt = sample(&threads);
+        printf("%d %d\n", p, threadAmt);
+        for(int t = 1; t <= threadAmt; t++) {
+            int burstAmt = sample(&bursts);
+            if(sorted) { // Arrivals rise through the file so it can be run with --stream
+                arrival += uniform(0, arrivalStep);
+                arrival = (arrival > maxArrival) ? maxArrival : arrival;
+            }
+            else {
+                arrival = uniform(0, maxArrival);
+            }
+            printf("%d %d %d\n", t, arrival, burstAmt);
+            for(int b = 1; b < burstAmt; b++) {
+                printf("%d %d %d\n", b, sample(&cpu), sample(&io));
+            }
+            printf("%d %d\n", burstAmt, sample(&cpu));
+        }
+    }
+    return 0;
+}
+
+// Returns the next 64 random bits
+unsigned long long nextRandom() {
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return rngState * 2685821657736338717ULL;
+}
+
+// Returns a random integer in [lo, hi]
+int uniform(int lo, int hi) {
+    return lo + (int)(nextRandom() % (unsigned long long)(hi - lo + 1));
+}
+
+// Draws one value from the distribution, never below 1 for exponential draws
+int sample(distribution* d) {
+    if(d->type == DIST_CONST) {
+        return d->lo;
+    }
+    if(d->type == DIST_UNIFORM) {
+        return uniform(d->lo, d->hi);
+    }
+    double u = (nextRandom() >> 11) * (1.0 / 9007199254740992.0); // 53 random bits in [0, 1)
+    return 1 + (int)(-log(1.0 - u) * d->mean);
+}
+
+// Parses N, LO-HI, or exp:MEAN into d
+bool parseDistribution(char* arg, distribution* d) {
+    int used = 0;
+    if(sscanf(arg, "exp:%lf%n", &(d->mean), &used) == 1 && arg[used] == '\0') {
+        d->type = DIST_EXP;
+        return d->mean > 0;
+    }
+    if(sscanf(arg, "%d-%d%n", &(d->lo), &(d->hi), &used) == 2 && arg[used] == '\0') {
+        d->type = DIST_UNIFORM;
+        return d->lo >= 0 && d->hi >= d->lo;
+    }
+    if(sscanf(arg, "%d%n", &(d->lo), &used) == 1 && arg[used] == '\0') {
+        d->type = DIST_CONST;
+        d->hi = d->lo;
+        return d->lo >= 0;
+    }
+    return false;
+}
@@ -1,300 +1,982 @@
 // Christian Catalano, Assignment 2, March 19th, 1120832
 #include "main.h"
 
-bool detailed = false; // flag for -d input param
-bool verbose = false; // flag for -v input param
-int RRTime = 0; // flag for -r input param
+#ifdef SIM_STATS
+__thread simStats stats;
+#endif
 char* enumString[5] = {"new", "ready", "running", "blocked", "terminated"}; // For printing thread info in verbose mode
-
+size_t enumLength[5] = {3, 5, 7, 7, 10};
+char* resultNames[RESULT_COLUMNS] = {"pno", "tno", "arrival", "finish", "service", "io", "turnaround", "waiting"}; // Column names of a results file
+policy policies[5] = { // Indexed by policyType
+    {"FCFS", createFifoQueue, pushFifoQueue, popFifoQueue, fifoQueueSize, freeFifoQueue, fifoQuantum, NULL, false},
+    {"Shortest Job First", createReadyHeap, pushShortest, popReadyHeap, readyHeapSize, freeReadyHeap, wholeBurst, NULL, false},
+    {"Shortest Remaining Time First", createReadyHeap, pushShortest, popReadyHeap, readyHeapSize, freeReadyHeap, wholeBurst, NULL, true},
+    {"Priority", createReadyHeap, pushPriority, popReadyHeap, readyHeapSize, freeReadyHeap, wholeBurst, NULL, false},
+    {"Multi-Level Feedback Queue", createMlfqQueue, pushMlfqQueue, popMlfqQueue, mlfqQueueSize, freeMlfqQueue, mlfqQuantum, mlfqExpire, false}
+};
+
+#ifndef SIMCPU_LIBRARY
 int main(int argc, char* argv[]) {
     /* Initialize DES Min heap */
-    process*** processes;
+    arena* a;
+    inputReader* in;
+    char* inputPath = NULL;
+    char* convertPath = NULL;
+    bool streaming = false;
+    arrivalStream* stream = NULL;
+    process* processes = NULL;
     int processAmt;
-    int threadSwitch;
-    int processSwitch;
     heap* h;
-
-    processes = (process***)calloc(1, sizeof(process**));
-    h = initializePriorityQueue(processes, &processAmt, &threadSwitch, &processSwitch);
-    if(!h) { // heap was not initialized correctly
-        fprintf(stderr, "Min-heap not initialized correctly. Exiting...\n");
-        freeProcesses(processes, processAmt);
-        return 1;
-    }   
+    runContext ctx = { .detailed = false, .verbose = false, .RRTime = 0, .eventQueueType = HEAP_QUEUE, .coreAmt = 1, .textTrace = NULL, .binaryTrace = NULL };
+    ctx.levelAmt = 3;
+    ctx.levelQuanta[0] = 8;
+    ctx.levelQuanta[1] = 16;
+    ctx.levelQuanta[2] = 0;
+    policyType type = POLICY_FIFO;
+    ctx.fastForward = true;
+    int ranges[SWEEP_PARAMS][3]; // lo, hi, step of each swept parameter
+    bool swept[SWEEP_PARAMS] = { false, false, false };
+    bool sweeping = false;
+    int workerAmt = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    char* tracePath = NULL;
+    char* statsPath = NULL;
+    char* resultsPath = NULL;
+    bool resultsCsv = false;
+    resultsSink* results = NULL;
+    bool resultsWritten = true;
+    char* checkpointPath = NULL;
+    long long checkpointInterval = CHECKPOINT_INTERVAL;
+    bool resume = false;
+    bool partitioned = false;
+    bool replaying = false;
+    long long replayUnit = 1000; // Nanoseconds of a scheduler log per time unit
+    int switchTimes[2] = { -1, -1 }; // --switch thread and process switch times, -1 keeps the input's
+    bool benchmark = false;
+    double phaseTimes[BENCH_PHASES] = {0}; // Seconds spent parsing, building the heap, in the event loop, and on stats
+    double phaseStart;
+
+    a = initializeArena();
+    processAmt = 0;
 
     /* Parse Input Parameters */
     for(int i = 1; i < argc; i++) {
         if(strcmp(argv[i], "-d") == 0) // -d flag was presented
-            detailed = true;
+            ctx.detailed = true;
         if(strcmp(argv[i], "-v") == 0) // -d flag was presented
-            verbose = true;
+            ctx.verbose = true;
         if(strcmp(argv[i], "-r") == 0) { // -r flag was presented
             i++;
             if(i >= argc) { // No time quantum presented
                 fprintf(stderr, "A time quantum is required with -r flag.\nUsage: simcpu [-d] [-r] [quantum] < input_file\n");
-                freeProcesses(processes, processAmt);
+                freeArena(a);
                 return(1);
             }
 
             // read time quantum in from argv
-            RRTime = atoi(argv[i]);
-            if(RRTime == 0) {
+            ctx.RRTime = atoi(argv[i]);
+            if(ctx.RRTime == 0) {
                 fprintf(stderr, "please indicate a numeric, positive time quantum.\nUsage: simcpu [-d] [-r] [quantum] < input_file\n");
-                freeProcesses(processes, processAmt);
+                freeArena(a);
                 return(1);
             }
         }
-    }
-
-    /* Run Simulation */
-    node* n;
-    thread* t;
-    int CPUUtilizationTime = 0;
-    int timeToAdd;
-    int prevPNo = -1;
-    int prevTNo = -1;
-    int currentTime = 0;
-    int timeInCpu = 0;
-    bool empty;
-    int delayAmt = 0;
-    heap* rq = initializeReadyQueue();
-    while(!isEmpty(rq) || !isEmpty(h)) { // While there are events in the ready queue or heap
-        if(!isEmpty(rq)) { // If ready queue has processes waiting
-            n = popReadyQueue(rq); // get FI process
-            t = (thread*)(n->data);
-            
-            // Update context switch based on last process' info
-            if( prevPNo != -1 && (prevPNo != t->PNo || prevTNo != t->TNo)) { 
-                if( prevPNo == t->PNo ) // Current thread is from the same process
-                    delayAmt = threadSwitch;
-                else // Current thread is from a different process
-                    delayAmt = processSwitch;
-            }
-            prevPNo = t->PNo;
-            prevTNo = t->TNo;
-            currentTime += delayAmt; // Add time for prev context switch
-
-            // Set state of current thread to running
-            if(t->s != RUNNING)
-                stateSwitch(t, RUNNING, currentTime);
-
-            // Add time to process thread
-            timeInCpu = consumeTime(n, &empty);
-            CPUUtilizationTime += timeInCpu;
-            currentTime += timeInCpu;
-
-            // push any arrivals that happened during this burst into the ready queue
-            while(minKey(h) <= currentTime && !isEmpty(h)) {
-                parseNextEvent(h, rq);
-            }
-
-            if(n->currBurst == t->burstNo - 1 && empty) { // Final burst
-                    stateSwitch(t, TERMINATED, currentTime);
-                    t->finTime = currentTime;
-                    if(verbose) // Print thread summary if verbose is turned on
-                        printThread(t);
+        if(strcmp(argv[i], "-q") == 0) { // -q flag was presented
+            i++;
+            if(i < argc && strcmp(argv[i], "heap") == 0)
+                ctx.eventQueueType = HEAP_QUEUE;
+            else if(i < argc && strcmp(argv[i], "wheel") == 0)
+                ctx.eventQueueType = WHEEL_QUEUE;
+            else {
+                fprintf(stderr, "-q requires an event queue type of heap or wheel.\nUsage: simcpu [-d] [-r] [quantum] [-q heap|wheel] < input_file\n");
+                freeArena(a);
+                return(1);
             }
-            else if(empty) { // Not final burst but done its cpu time for this burst
-                stateSwitch(t, BLOCKED, currentTime);
-                timeToAdd = consumeTime(n, &empty); // Get time for this IO Burst
-                insertItem(h, currentTime + timeToAdd, t, n->currBurst); // Add this thread's "switch to IO" into the event queue
+        }
+        if(strcmp(argv[i], "-f") == 0) { // -f flag was presented
+            i++;
+            if(i >= argc) { // No file presented
+                fprintf(stderr, "An input file is required with -f flag.\nUsage: simcpu [-d] [-r] [quantum] [-f input_file]\n");
+                freeArena(a);
+                return(1);
             }
-            else if(!empty) { // RR and its not done its current burst
-                stateSwitch(t, READY, currentTime);
-                pushReadyQueue(rq, t, n->currBurst);
+            inputPath = argv[i];
+        }
+        if(strcmp(argv[i], "--convert") == 0) { // --convert flag was presented
+            i++;
+            if(i >= argc) { // No file presented
+                fprintf(stderr, "An output file is required with --convert flag.\nUsage: simcpu [-f input_file] --convert output_file\n");
+                freeArena(a);
+                return(1);
             }
+            convertPath = argv[i];
         }
-        else { // Ready queue empty, grab next event in sim
-            prevPNo = -1; // CPU is idle, no previous process
-            prevTNo = -1;
-            delayAmt = 0;
-            currentTime = minKey(h); // update current time to this event
-            parseNextEvent(h, rq);
+        if(strcmp(argv[i], "--stream") == 0) // --stream flag was presented
+            streaming = true;
+        if(strcmp(argv[i], "--trace") == 0) { // --trace flag was presented
+            i++;
+            if(i >= argc) { // No file presented
+                fprintf(stderr, "An output file is required with --trace flag.\nUsage: simcpu [-d] [-r] [quantum] --trace trace_file < input_file\n");
+                freeArena(a);
+                return(1);
+            }
+            tracePath = argv[i];
+        }
+        if(strcmp(argv[i], "--render-trace") == 0) { // --render-trace flag was presented
+            i++;
+            if(i >= argc) { // No file presented
+                fprintf(stderr, "A trace file is required with --render-trace flag.\nUsage: simcpu --render-trace trace_file\n");
+                freeArena(a);
+                return(1);
+            }
+            freeArena(a);
+            return renderTrace(argv[i]) ? 0 : 1;
+        }
+        if(strcmp(argv[i], "--results") == 0 || strcmp(argv[i], "--results-csv") == 0) { // --results or --results-csv flag was presented
+            resultsCsv = (strcmp(argv[i], "--results-csv") == 0);
+            i++;
+            if(i >= argc) { // No file presented
+                fprintf(stderr, "An output file is required with --results and --results-csv flags.\nUsage: simcpu [-r] [quantum] [--results results_file | --results-csv csv_file] < input_file\n");
+                freeArena(a);
+                return(1);
+            }
+            resultsPath = argv[i];
+        }
+        if(strcmp(argv[i], "--bench") == 0) // --bench flag was presented
+            benchmark = true;
+        if(strcmp(argv[i], "--stats") == 0) { // --stats flag was presented
+            i++;
+#ifndef SIM_STATS
+            fprintf(stderr, "--stats requires a build with counters, run make STATS=1.\n");
+            freeArena(a);
+            return(1);
+#endif
+            if(i >= argc) { // No file presented
+                fprintf(stderr, "An output file is required with --stats flag.\nUsage: simcpu [-d] [-r] [quantum] --stats stats_file < input_file\n");
+                freeArena(a);
+                return(1);
+            }
+            statsPath = argv[i];
+        }
+        if(strcmp(argv[i], "--no-fast-forward") == 0) // --no-fast-forward flag was presented
+            ctx.fastForward = false;
+        if(strcmp(argv[i], "--checkpoint") == 0) { // --checkpoint flag was presented
+            i++;
+            if(i >= argc) { // No file presented
+                fprintf(stderr, "A checkpoint file is required with --checkpoint flag.\nUsage: simcpu [-d] [-r] [quantum] --checkpoint checkpoint_file [--checkpoint-every events] [--resume] < input_file\n");
+                freeArena(a);
+                return(1);
+            }
+            checkpointPath = argv[i];
+        }
+        if(strcmp(argv[i], "--checkpoint-every") == 0) { // --checkpoint-every flag was presented
+            i++;
+            if(i >= argc || atoll(argv[i]) <= 0) { // No interval presented
+                fprintf(stderr, "please indicate a numeric, positive event count with --checkpoint-every flag.\nUsage: simcpu [-d] [-r] [quantum] --checkpoint checkpoint_file [--checkpoint-every events] [--resume] < input_file\n");
+                freeArena(a);
+                return(1);
+            }
+            checkpointInterval = atoll(argv[i]);
+        }
+        if(strcmp(argv[i], "--resume") == 0) // --resume flag was presented
+            resume = true;
+        if(strcmp(argv[i], "--partition") == 0) // --partition flag was presented
+            partitioned = true;
+        if(strcmp(argv[i], "--replay") == 0) // --replay flag was presented
+            replaying = true;
+        if(strcmp(argv[i], "--replay-unit") == 0) { // --replay-unit flag was presented
+            i++;
+            if(i >= argc || atoll(argv[i]) <= 0) { // No unit presented
+                fprintf(stderr, "please indicate a numeric, positive number of nanoseconds with --replay-unit flag.\nUsage: simcpu [-d] [-r] [quantum] --replay [--replay-unit ns] [--switch thread,process] < sched_log\n");
+                freeArena(a);
+                return(1);
+            }
+            replayUnit = atoll(argv[i]);
+        }
+        if(strcmp(argv[i], "--switch") == 0) { // --switch flag was presented
+            i++;
+            if(i >= argc || sscanf(argv[i], "%d,%d", &(switchTimes[0]), &(switchTimes[1])) != 2 || switchTimes[0] < 0 || switchTimes[1] < 0) {
+                fprintf(stderr, "--switch requires non-negative thread and process switch times like 3,7.\nUsage: simcpu [-d] [-r] [quantum] [--switch thread,process] < input_file\n");
+                freeArena(a);
+                return(1);
+            }
+        }
+        if(strcmp(argv[i], "--io-channels") == 0) { // --io-channels flag was presented
+            i++;
+            if(i >= argc || atoi(argv[i]) <= 0) { // No channel count presented
+                fprintf(stderr, "please indicate a numeric, positive channel count with --io-channels flag.\nUsage: simcpu [-d] [-r] [quantum] [--io-channels channels] [--io-sched fifo|elevator] < input_file\n");
+                freeArena(a);
+                return(1);
+            }
+            ctx.ioChannels = atoi(argv[i]);
+        }
+        if(strcmp(argv[i], "--io-sched") == 0) { // --io-sched flag was presented
+            i++;
+            if(i < argc && strcmp(argv[i], "fifo") == 0)
+                ctx.ioSchedule = IO_FIFO;
+            else if(i < argc && strcmp(argv[i], "elevator") == 0)
+                ctx.ioSchedule = IO_ELEVATOR;
+            else {
+                fprintf(stderr, "--io-sched requires an I/O queue order of fifo or elevator.\nUsage: simcpu [-d] [-r] [quantum] [--io-channels channels] [--io-sched fifo|elevator] < input_file\n");
+                freeArena(a);
+                return(1);
+            }
+        }
+        if(strcmp(argv[i], "-c") == 0) { // -c flag was presented
+            i++;
+            if(i >= argc || atoi(argv[i]) <= 0) { // No core count presented
+                fprintf(stderr, "please indicate a numeric, positive core count with -c flag.\nUsage: simcpu [-d] [-r] [quantum] [-c cores] < input_file\n");
+                freeArena(a);
+                return(1);
+            }
+            ctx.coreAmt = atoi(argv[i]);
+        }
+        if(strcmp(argv[i], "--sweep") == 0) { // --sweep flag was presented
+            i++;
+            int param = (i < argc) ? parseSweepRange(argv[i], NULL) : -1;
+            if(param == -1) { // No valid range presented
+                fprintf(stderr, "--sweep requires a range like quantum=1..200:5, parameters are quantum, threadswitch and processswitch.\nUsage: simcpu [-r] [quantum] [-c cores] [-j workers] --sweep param=lo..hi[:step] < input_file\n");
+                freeArena(a);
+                return(1);
+            }
+            parseSweepRange(argv[i], ranges[param]);
+            swept[param] = true;
+            sweeping = true;
+        }
+        if(strcmp(argv[i], "-j") == 0) { // -j flag was presented
+            i++;
+            if(i >= argc || atoi(argv[i]) <= 0) { // No worker count presented
+                fprintf(stderr, "please indicate a numeric, positive worker count with -j flag.\nUsage: simcpu [-r] [quantum] [-j workers] --sweep param=lo..hi[:step] < input_file\n");
+                freeArena(a);
+                return(1);
+            }
+            workerAmt = atoi(argv[i]);
+        }
+        if(strcmp(argv[i], "-p") == 0) { // -p flag was presented
+            i++;
+            char* names[5] = {"fcfs", "sjf", "srtf", "priority", "mlfq"};
+            int j = 0;
+            while(i < argc && j < 5 && strcmp(argv[i], names[j]) != 0) { j++; }
+            if(i >= argc || j == 5) {
+                fprintf(stderr, "-p requires a policy of fcfs, sjf, srtf, priority or mlfq.\nUsage: simcpu [-d] [-p policy] [--levels quanta] < input_file\n");
+                freeArena(a);
+                return(1);
+            }
+            type = (policyType)j;
+        }
+        if(strcmp(argv[i], "--levels") == 0) { // --levels flag was presented
+            i++;
+            if(i >= argc || !parseLevels(argv[i], &ctx)) {
+                fprintf(stderr, "--levels requires 1 to %d comma separated MLFQ quanta, 0 runs bursts to completion.\nUsage: simcpu [-d] -p mlfq [--levels quanta] < input_file\n", MLFQ_MAX_LEVELS);
+                freeArena(a);
+                return(1);
+            }
+        }
+    }
+    if(!setPolicy(&ctx, type)) {
+        fprintf(stderr, "-r can only be used with the fcfs policy.\n");
+        freeArena(a);
+        return(1);
+    }
+    if(resume && checkpointPath == NULL) {
+        fprintf(stderr, "--resume requires --checkpoint with the file to resume from.\n");
+        freeArena(a);
+        return(1);
+    }
+    if(checkpointPath != NULL && (streaming || sweeping || tracePath != NULL || ctx.ioChannels > 0)) {
+        fprintf(stderr, "--checkpoint can't be combined with --stream, --sweep, --trace or --io-channels.\n");
+        freeArena(a);
+        return(1);
+    }
+    if(partitioned && (streaming || sweeping || checkpointPath != NULL || statsPath != NULL || ctx.ioChannels > 0)) {
+        fprintf(stderr, "--partition can't be combined with --stream, --sweep, --checkpoint, --stats or --io-channels.\n");
+        freeArena(a);
+        return(1);
+    }
+    if(replaying && streaming) {
+        fprintf(stderr, "--replay can't be combined with --stream, the log is already read in one pass.\n");
+        freeArena(a);
+        return(1);
+    }
+    bool parallel = partitioned && !ctx.verbose && tracePath == NULL; // Traces need the shared loop to interleave the cores' events in time order
+    if(sweeping && (streaming || ctx.verbose || ctx.detailed || convertPath != NULL || tracePath != NULL || statsPath != NULL || resultsPath != NULL)) {
+        fprintf(stderr, "--sweep can't be combined with -d, -v, --stream, --convert, --trace, --stats or --results.\n");
+        freeArena(a);
+        return(1);
+    }
+
+    in = openInput(inputPath);
+    if(!in) {
+        fprintf(stderr, "Could not open input file %s.\n", inputPath);
+        freeArena(a);
+        return 1;
+    }
+    phaseStart = getTime();
+    if(streaming) { // Threads are read as the simulation reaches their arrival time
+        stream = openArrivalStream(in, &(ctx.threadSwitch), &(ctx.processSwitch));
+        phaseTimes[BENCH_PARSE] = getTime() - phaseStart;
+        h = (stream != NULL) ? initializeHeap(0, ctx.eventQueueType) : NULL;
+    }
+    else if(replaying ? loadReplay(in, a, &processes, &processAmt, replayUnit) : loadWorkload(in, a, &processes, &processAmt, &ctx)) {
+        if(replaying) { // Logs don't record switch costs
+            ctx.threadSwitch = 0;
+            ctx.processSwitch = 0;
+        }
+        phaseTimes[BENCH_PARSE] = getTime() - phaseStart;
+        phaseStart = getTime();
+        ctx.processCore = partitioned ? assignPartitions(processes, processAmt, ctx.coreAmt) : NULL;
+        h = parallel ? initializeHeap(0, ctx.eventQueueType) : heapFromProcesses(processes, processAmt, ctx.eventQueueType); // Partitions build their own
+        phaseTimes[BENCH_HEAP] = getTime() - phaseStart;
+    }
+    else {
+        h = NULL;
+    }
+    if(!h) { // heap was not initialized correctly
+        fprintf(stderr, "Min-heap not initialized correctly. Exiting...\n");
+        closeInput(in);
+        freeArena(a);
+        return 1;
+    }   
+    if(switchTimes[0] >= 0) {
+        ctx.threadSwitch = switchTimes[0];
+        ctx.processSwitch = switchTimes[1];
+    }
+
+    /* Convert Input to a Binary Workload */
+    if(convertPath != NULL && !streaming) {
+        bool written = writeBinaryWorkload(convertPath, processes, processAmt, ctx.threadSwitch, ctx.processSwitch);
+        if(!written)
+            fprintf(stderr, "Could not write binary workload to %s.\n", convertPath);
+        closeInput(in);
+        freeArena(a);
+        freeHeap(h);
+        free(ctx.processCore);
+        return written ? 0 : 1;
+    }
+
+    /* Run Every Configuration of a Sweep */
+    if(sweeping) {
+        freeHeap(h); // Each run builds its own event queue
+        sweep s = { .processes = processes, .processAmt = processAmt, .nextRun = 0 };
+        s.runs = buildSweepRuns(&ctx, ranges, swept, &(s.runAmt));
+        bool finished = runSweep(&s, workerAmt);
+        if(finished)
+            printSweepResults(&s);
+        else
+            fprintf(stderr, "Could not start sweep workers.\n");
+        free(s.runs);
+        closeInput(in);
+        freeArena(a);
+        return finished ? 0 : 1;
+    }
+
+    /* Run Simulation */
+    FILE* traceFile = NULL;
+    if(tracePath != NULL) {
+        traceFile = fopen(tracePath, "wb");
+        if(traceFile == NULL) {
+            fprintf(stderr, "Could not open trace file %s.\n", tracePath);
+            closeArrivalStream(stream);
+            closeInput(in);
+            freeArena(a);
+            freeHeap(h);
+            free(ctx.processCore);
+            return 1;
+        }
+    }
+    if(resultsPath != NULL) {
+        results = openResults(resultsPath, resultsCsv);
+        if(results == NULL) {
+            fprintf(stderr, "Could not open results file %s.\n", resultsPath);
+            if(traceFile != NULL)
+                fclose(traceFile);
+            closeArrivalStream(stream);
+            closeInput(in);
+            freeArena(a);
+            freeHeap(h);
+            free(ctx.processCore);
+            return 1;
         }
     }
+    ctx.results = (stream != NULL) ? results : NULL; // Streamed threads are gone by the end of the run
+    ctx.textTrace = ctx.verbose ? openTrace(stdout, true) : NULL;
+    ctx.binaryTrace = (traceFile != NULL) ? openTrace(traceFile, false) : NULL;
+    phaseStart = getTime();
+    core* cores = initializeCores(&ctx);
+    ctx.checkpoint = (checkpointPath != NULL) ? openCheckpoints(checkpointPath, checkpointInterval, processes, processAmt) : NULL;
+    if(resume && !resumeCheckpoint(ctx.checkpoint, &ctx, h, cores)) {
+        closeCheckpoints(ctx.checkpoint);
+        closeTrace(ctx.textTrace);
+        closeInput(in);
+        freeArena(a);
+        freeHeap(h);
+        freeCores(&ctx, cores);
+        return 1;
+    }
+    if(parallel && !runPartitions(&ctx, processes, processAmt, cores, workerAmt)) {
+        fprintf(stderr, "Could not start partition workers.\n");
+        closeInput(in);
+        freeArena(a);
+        freeHeap(h);
+        freeCores(&ctx, cores);
+        free(ctx.processCore);
+        return 1;
+    }
+    else if(!parallel) {
+        runSimulation(&ctx, h, cores, stream, (stream != NULL) ? stream->processAmt : processAmt);
+    }
+    closeTrace(ctx.textTrace);
+    bool traceWritten = closeTrace(ctx.binaryTrace);
+    if(!closeCheckpoints(ctx.checkpoint))
+        fprintf(stderr, "Could not write checkpoint %s.\n", checkpointPath);
+    phaseTimes[BENCH_LOOP] = getTime() - phaseStart;
+    if(traceFile != NULL && !((fclose(traceFile) == 0) && traceWritten)) {
+        fprintf(stderr, "Could not write trace file %s, it is incomplete.\n", tracePath);
+        traceWritten = false;
+    }
+
+    if(stream != NULL && stream->failed) { // Input was malformed partway through
+        fprintf(stderr, "Min-heap not initialized correctly. Exiting...\n");
+        closeArrivalStream(stream);
+        closeInput(in);
+        freeArena(a);
+        freeHeap(h);
+        freeCores(&ctx, cores);
+        return 1;
+    }
 
     /* Print Statistics */
+    phaseStart = getTime();
     printf("------------------------------------------------------------\n");
-    if(RRTime == 0)
+    if(ctx.policyType == POLICY_MLFQ) {
+        printf("%s Scheduling (quanta =", ctx.sched->name);
+        for(int i = 0; i < ctx.levelAmt; i++) {
+            printf(" %d", ctx.levelQuanta[i]);
+        }
+        printf(" time units)\n");
+    }
+    else if(ctx.policyType != POLICY_FIFO)
+        printf("%s Scheduling\n", ctx.sched->name);
+    else if(ctx.RRTime == 0)
         printf("FCFS Scheduling\n");
     else
-        printf("Round Robin Scheduling (quantum = %d time units)\n", RRTime);
-
-    printf("Total Time required is %d units\n", currentTime);
-    printf("Average Turnaround Time is %.1f time units\n", getAverageTurnaroundTime(*processes, processAmt));
-    if(currentTime != 0)
-        printf("CPU Utilization is %0.1f%%\n", ((float)CPUUtilizationTime / (float)currentTime) * 100);
+        printf("Round Robin Scheduling (quantum = %d time units)\n", ctx.RRTime);
+
+    printf("Total Time required is %d units\n", ctx.totalTime);
+    printf("Average Turnaround Time is %.1f time units\n", ctx.avgTurnaround);
+    printf("Average Waiting Time is %.1f time units\n", ctx.avgWaiting);
+    printf("Average Response Time is %.1f time units\n", ctx.avgResponse);
+    printf("Thread Turnaround Time p50/p95/p99 is %d/%d/%d time units\n", ctx.turnaroundPercentiles[0], ctx.turnaroundPercentiles[1], ctx.turnaroundPercentiles[2]);
+    if(ctx.totalTime != 0)
+        printf("CPU Utilization is %0.1f%%\n", ((float)ctx.busyTime / ((float)ctx.totalTime * ctx.coreAmt)) * 100);
     else
         printf("CPU Utilization is 0%%\n");
+    for(int i = 0; i < ctx.coreAmt && ctx.coreAmt > 1; i++) {
+        if(ctx.totalTime != 0)
+            printf("Core %d Utilization is %0.1f%%\n", i, ((float)cores[i].busyTime / (float)ctx.totalTime) * 100);
+        else
+            printf("Core %d Utilization is 0%%\n", i);
+    }
+    if(ctx.ioChannels > 0) {
+        if(ctx.totalTime != 0)
+            printf("I/O Utilization is %0.1f%% (%d channel%s)\n", ((double)ctx.ioBusyTime / ((double)ctx.totalTime * ctx.ioChannels)) * 100, ctx.ioChannels, (ctx.ioChannels == 1) ? "" : "s");
+        else
+            printf("I/O Utilization is 0%% (%d channel%s)\n", ctx.ioChannels, (ctx.ioChannels == 1) ? "" : "s");
+        printf("Average I/O Queue Depth is %.2f (max %d)\n", ctx.avgIoQueue, ctx.maxIoQueue);
+    }
 
-    if( detailed ) {
-        printProcesses(*processes, processAmt);
+    if( ctx.detailed && stream == NULL ) {
+        printProcesses(processes, processAmt);
+    }
+    if(results != NULL) {
+        if(stream == NULL)
+            recordResults(results, processes, processAmt);
+        resultsWritten = closeResults(results);
+        if(!resultsWritten)
+            fprintf(stderr, "Could not write results to %s.\n", resultsPath);
     }
     printf("------------------------------------------------------------\n");
-    freeProcesses(processes, processAmt);
+    fflush(stdout);
+    phaseTimes[BENCH_STATS] = getTime() - phaseStart;
+    if(benchmark)
+        printBenchmark(phaseTimes, ctx.eventAmt);
+#ifdef SIM_STATS
+    if(statsPath != NULL && !writeStats(statsPath, phaseTimes, &ctx))
+        fprintf(stderr, "Could not write stats to %s.\n", statsPath);
+#endif
+    closeArrivalStream(stream);
+    closeInput(in); // Binary workloads point into the input mapping
+    freeArena(a);
     freeHeap(h);
-    freeHeap(rq);
-    return 0;
+    freeCores(&ctx, cores);
+    free(ctx.processCore);
+    return (traceWritten && resultsWritten) ? 0 : 1;
+}
+#endif /* SIMCPU_LIBRARY */
+
+/* LIBRARY FUNCTIONS */
+
+// Fills cfg with the defaults: FCFS on one core using the workload's switch times
+void sim_init_config(sim_config* cfg) {
+    cfg->policy = POLICY_FIFO;
+    cfg->quantum = 0;
+    cfg->levelAmt = 3;
+    cfg->levelQuanta[0] = 8;
+    cfg->levelQuanta[1] = 16;
+    cfg->levelQuanta[2] = 0;
+    cfg->cores = 1;
+    cfg->fastForward = true;
+    cfg->trace = NULL;
+    cfg->wheel = false;
+    cfg->verbose = false;
+    cfg->threadSwitch = -1;
+    cfg->processSwitch = -1;
+    cfg->ioChannels = 0;
+    cfg->elevator = false;
+}
+
+// Reads a workload from path, or a text workload from stdin if path is NULL
+// Returns NULL if the input can't be opened or is malformed, must be freed with sim_free
+workload* sim_load(char* path) {
+    workload* w = (workload*)malloc(sizeof(workload));
+    w->a = initializeArena();
+    w->in = openInput(path);
+    w->dirty = false;
+    runContext ctx;
+    if(!w->in || !loadWorkload(w->in, w->a, &(w->processes), &(w->processAmt), &ctx)) {
+        closeInput(w->in);
+        freeArena(w->a);
+        free(w);
+        return NULL;
+    }
+    w->threadSwitch = ctx.threadSwitch;
+    w->processSwitch = ctx.processSwitch;
+    return w;
+}
+
+// Simulates w with cfg and stores the statistics in res
+// Separate workloads can be run concurrently, a single workload can only be run by one thread at a time
+bool sim_run(workload* w, sim_config* cfg, sim_result* res) {
+    if(w == NULL || cfg->policy < POLICY_FIFO || cfg->policy > POLICY_MLFQ || cfg->quantum < 0 || cfg->cores <= 0 || cfg->ioChannels < 0
+    || cfg->levelAmt <= 0 || cfg->levelAmt > MLFQ_MAX_LEVELS) {
+        return false;
+    }
+    for(int i = 0; i < cfg->levelAmt; i++) {
+        if(cfg->levelQuanta[i] < 0) { // Same as --levels
+            return false;
+        }
+    }
+    if(w->dirty) {
+        sim_reset(w);
+    }
+
+    runContext ctx = { .detailed = false, .verbose = cfg->verbose, .RRTime = cfg->quantum, .coreAmt = cfg->cores };
+    ctx.eventQueueType = cfg->wheel ? WHEEL_QUEUE : HEAP_QUEUE;
+    ctx.threadSwitch = (cfg->threadSwitch >= 0) ? cfg->threadSwitch : w->threadSwitch;
+    ctx.processSwitch = (cfg->processSwitch >= 0) ? cfg->processSwitch : w->processSwitch;
+    ctx.levelAmt = cfg->levelAmt;
+    ctx.fastForward = cfg->fastForward;
+    ctx.ioChannels = cfg->ioChannels;
+    ctx.ioSchedule = cfg->elevator ? IO_ELEVATOR : IO_FIFO;
+    memcpy(ctx.levelQuanta, cfg->levelQuanta, cfg->levelAmt * sizeof(int));
+    if(!setPolicy(&ctx, cfg->policy)) {
+        return false;
+    }
+
+    ctx.textTrace = cfg->verbose ? openTrace(stdout, true) : NULL;
+    ctx.binaryTrace = (cfg->trace != NULL) ? openTrace(cfg->trace, false) : NULL;
+    heap* h = heapFromProcesses(w->processes, w->processAmt, ctx.eventQueueType);
+    core* cores = initializeCores(&ctx);
+    runSimulation(&ctx, h, cores, NULL, w->processAmt);
+    closeTrace(ctx.textTrace);
+    bool traceWritten = closeTrace(ctx.binaryTrace);
+    w->dirty = true;
+    freeCores(&ctx, cores);
+    freeHeap(h);
+
+    res->totalTime = ctx.totalTime;
+    res->events = ctx.eventAmt;
+    res->busyTime = ctx.busyTime;
+    res->avgTurnaround = ctx.avgTurnaround;
+    res->avgWaiting = ctx.avgWaiting;
+    res->avgResponse = ctx.avgResponse;
+    res->turnaroundP50 = ctx.turnaroundPercentiles[0];
+    res->turnaroundP95 = ctx.turnaroundPercentiles[1];
+    res->turnaroundP99 = ctx.turnaroundPercentiles[2];
+    res->cpuUtilization = (ctx.totalTime != 0) ? ((float)ctx.busyTime / ((float)ctx.totalTime * ctx.coreAmt)) * 100 : 0;
+    res->ioUtilization = (ctx.ioChannels > 0 && ctx.totalTime != 0) ? ((double)ctx.ioBusyTime / ((double)ctx.totalTime * ctx.ioChannels)) * 100 : 0;
+    res->avgIoQueue = ctx.avgIoQueue;
+    res->maxIoQueue = ctx.maxIoQueue;
+    return traceWritten;
+}
+
+// Restores every thread of w, and its remaining burst times, from cpuTime/ioTime so it can be simulated again
+void sim_reset(workload* w) {
+    resetProcesses(w->processes, w->processAmt);
+    w->dirty = false;
+}
+
+// Frees the workload and closes its input
+void sim_free(workload* w) {
+    if(w != NULL) {
+        closeInput(w->in);
+        freeArena(w->a);
+        free(w);
+    }
+}
+
+/* SIMULATION FUNCTIONS */
+
+// Runs the simulation until every thread has terminated
+// Total time, busy time, and the turnaround, waiting, and response statistics are stored in ctx, per-core busy time is left in cores
+// The policy and tracing never change during a run, so each combination gets its own copy of the loop
+void runSimulation(runContext* ctx, heap* h, core* cores, arrivalStream* stream, int processAmt) {
+    bool traced = (ctx->textTrace != NULL || ctx->binaryTrace != NULL);
+    if(ctx->policyType == POLICY_FIFO && ctx->RRTime == 0)
+        (traced ? runFcfsTraced : runFcfsSilent)(ctx, h, cores, stream, processAmt);
+    else if(ctx->policyType == POLICY_FIFO)
+        (traced ? runRoundRobinTraced : runRoundRobinSilent)(ctx, h, cores, stream, processAmt);
+    else
+        (traced ? runPolicyTraced : runPolicySilent)(ctx, h, cores, stream, processAmt);
+}
+
+#define SIM_VARIANT(name, kind, traced) \
+void name(runContext* ctx, heap* h, core* cores, arrivalStream* stream, int processAmt) { \
+    simulate(ctx, h, cores, stream, processAmt, kind, traced); \
+}
+SIM_VARIANT(runFcfsSilent, LOOP_FCFS, false)
+SIM_VARIANT(runFcfsTraced, LOOP_FCFS, true)
+SIM_VARIANT(runRoundRobinSilent, LOOP_ROUND_ROBIN, false)
+SIM_VARIANT(runRoundRobinTraced, LOOP_ROUND_ROBIN, true)
+SIM_VARIANT(runPolicySilent, LOOP_POLICY, false)
+SIM_VARIANT(runPolicyTraced, LOOP_POLICY, true)
+
+// The simulation loop, kind and traced are constants in every copy
+SIM_INLINE void simulate(runContext* ctx, heap* h, core* cores, arrivalStream* stream, int processAmt, loopKind kind, bool traced) {
+    node n;
+    thread* t;
+    int timeToAdd;
+    int currentTime = 0;
+    int c;
+    int target;
+    int limit; // Time of the next event, slices ending before it can be finished right away
+    bool running = false; // Any core is running a slice
+    int coreAmt = ctx->coreAmt;
+    ctx->device = (ctx->ioChannels > 0) ? initializeDevice(ctx->ioChannels, ctx->ioSchedule) : NULL;
+    if(ctx->checkpoint != NULL && ctx->checkpoint->resumed) { // Picks up where the snapshot left off
+        currentTime = ctx->checkpoint->resumeTime;
+        for(int i = 0; i < coreAmt && !running; i++) {
+            running = cores[i].running;
+        }
+    }
+    else {
+        ctx->eventAmt = 0;
+        initializeMetrics(&(ctx->metrics), processAmt);
+    }
+    while(running || !isEmpty(h) || (stream != NULL && stream->next != NULL)) { // While there are slices running, or events in the heap or input
+        if(ctx->checkpoint != NULL && ctx->eventAmt >= ctx->checkpoint->nextAt)
+            takeCheckpoint(ctx->checkpoint, ctx, h, cores, currentTime);
+
+        // Find the core whose slice ends first
+        c = -1;
+        for(int i = 0; i < coreAmt; i++) {
+            if(cores[i].running && (c == -1 || cores[i].busyUntil < cores[c].busyUntil))
+                c = i;
+        }
+
+        // Next event is an arrival that hasn't been read yet
+        if(stream != NULL && stream->next != NULL && (isEmpty(h) || stream->next->arrTime <= minKey(h)) 
+        && (c == -1 || stream->next->arrTime <= cores[c].busyUntil))
+            feedArrivals(stream, h, stream->next->arrTime);
+
+        if(!isEmpty(h) && (c == -1 || minKey(h) <= cores[c].busyUntil)) { // Next event happens before the first slice ends
+            currentTime = minKey(h); // update current time to this event
+            ctx->eventAmt++;
+            target = parseNextEvent(ctx, h, cores, kind, traced);
+            if(!cores[target].running) { // Core was idle, start it right away
+                dispatchCore(ctx, cores, target, currentTime, kind, traced);
+                running = true;
+            }
+            else if(kind == LOOP_POLICY && ctx->sched->preemptive) {
+                preemptCore(ctx, cores, target, currentTime, kind, traced);
+            }
+            continue;
+        }
+
+        // Finish the slice on core c
+        // While c is the only core running and its slices end before the next event, keep going without returning to the event loop
+        limit = ctx->fastForward ? nextEventTime(h, stream) : -1;
+        do {
+            currentTime = cores[c].busyUntil;
+            ctx->eventAmt++;
+            n = cores[c].current;
+            t = (thread*)(n.data);
+            if(n.currBurst == t->burstNo - 1 && cores[c].currentEmpty) { // Final burst
+                    stateSwitch(ctx, t, TERMINATED, currentTime, traced);
+                    t->finTime = currentTime;
+                    recordTermination(&(ctx->metrics), t);
+                    if(ctx->textTrace != NULL) // Print thread summary if verbose is turned on
+                        traceThread(ctx->textTrace, t);
+                    else if(ctx->detailed && stream != NULL) // Streamed threads can't be printed at the end
+                        printThread(t);
+                    if(ctx->results != NULL)
+                        recordResult(ctx->results, t);
+                    if(stream != NULL)
+                        releaseStreamThread(stream, t);
+            }
+            else if(cores[c].currentEmpty) { // Not final burst but done its cpu time for this burst
+                stateSwitch(ctx, t, BLOCKED, currentTime, traced);
+                timeToAdd = consumeTime(ctx, &n, &(cores[c].currentEmpty), kind); // Get time for this IO Burst
+                bool started = (ctx->device == NULL || requestIo(ctx->device, t, n.currBurst, timeToAdd, currentTime)); // Waits in the device queue if every channel is busy
+                if(started && currentTime + timeToAdd < limit && readySize(ctx, cores[c].rq, kind) == 0 && soleCore(ctx, cores, c)) { // Nothing else happens until the IO finishes, skip the event queue
+                    dispatchCore(ctx, cores, c, currentTime, kind, traced); // Idles the core
+                    currentTime += timeToAdd;
+                    ctx->eventAmt++; // Counted like the event it replaces
+                    if(ctx->device != NULL)
+                        finishIo(ctx->device, h, currentTime);
+                    stateSwitch(ctx, t, READY, currentTime, traced);
+                    pushReady(ctx, cores[c].rq, t, n.currBurst, kind);
+                    STAT_MAX(maxReadyQueue, readySize(ctx, cores[c].rq, kind));
+                }
+                else if(started) {
+                    insertItem(h, currentTime + timeToAdd, t, n.currBurst); // Add this thread's "switch to IO" into the event queue
+                    limit = min(limit, currentTime + timeToAdd);
+                }
+            }
+            else { // RR and its not done its current burst
+                stateSwitch(ctx, t, READY, currentTime, traced);
+                if(kind == LOOP_POLICY && ctx->sched->expire != NULL)
+                    ctx->sched->expire(ctx, t);
+                pushReady(ctx, cores[c].rq, t, n.currBurst, kind);
+                STAT_MAX(maxReadyQueue, readySize(ctx, cores[c].rq, kind));
+            }
+
+            // Start the next slice on this core
+            dispatchCore(ctx, cores, c, currentTime, kind, traced);
+        } while(cores[c].running && cores[c].busyUntil < limit && soleCore(ctx, cores, c));
+        running = false;
+        for(int i = 0; i < coreAmt && !running; i++) {
+            running = cores[i].running;
+        }
+    }
+
+    ctx->totalTime = currentTime;
+    ctx->busyTime = 0;
+    for(int i = 0; i < coreAmt; i++) {
+        ctx->busyTime += cores[i].busyTime;
+    }
+    finishMetrics(ctx);
+    finishDevice(ctx);
+}
+
+// Returns the time of the next event in the heap or the input, INT_MAX if there are none
+int nextEventTime(heap* h, arrivalStream* stream) {
+    int time = isEmpty(h) ? INT_MAX : minKey(h);
+    if(stream != NULL && stream->next != NULL)
+        time = min(time, stream->next->arrTime);
+    return time;
+}
+
+// Checks whether core c is the only core running a slice
+bool soleCore(runContext* ctx, core* cores, int c) {
+    for(int i = 0; i < ctx->coreAmt; i++) {
+        if(i != c && cores[i].running)
+            return false;
+    }
+    return true;
 }
 
 // Returns the current amount of time that this burst will execute for and consumes it in the thread
-int consumeTime(node* n, bool* emptyFlag) {
+SIM_INLINE int consumeTime(runContext* ctx, node* n, bool* emptyFlag, loopKind kind) {
     thread* t = (thread*)n->data;
-    cpuBurst** b = t->bursts;
-    int bNo = n->currBurst;
 
-    int num = b[bNo]->currCpuTime; // Pull the CPU time from the current burst
+    int num = t->remCpu; // Pull the CPU time from the current burst
     if(num != 0) { // CPU time hasnt been consumed yet for this burst
-        if(RRTime == 0) { //FCFS
-            b[bNo]->currCpuTime = 0;
+        int quantum = (kind == LOOP_FCFS) ? 0 : (kind == LOOP_ROUND_ROBIN) ? ctx->RRTime : ctx->sched->quantum(ctx, t);
+        if(quantum == 0) { //FCFS
+            t->remCpu = 0;
             *emptyFlag = true;
         }
         else { //RR with time quantum of [amt]
-            num = min(b[bNo]->currCpuTime, RRTime);  // Reduce time left in this burst by the min of time quantum and time remaining
-            b[bNo]->currCpuTime -= num;
+            num = min(num, quantum);  // Reduce time left in this burst by the min of time quantum and time remaining
+            t->remCpu -= num;
 
-            *emptyFlag = (b[bNo]->currCpuTime == 0); // See if there is any cpu burst left, set empty flag if not
+            *emptyFlag = (t->remCpu == 0); // See if there is any cpu burst left, set empty flag if not
         }
     }
     else { // Consume IO Time
-        num = b[bNo]->currIoTime;
-        b[bNo]->currIoTime = 0;
+        num = t->remIo;
+        t->remIo = 0;
         *emptyFlag = true;
         n->currBurst ++;
+        if(n->currBurst < t->burstNo) { // Load the next burst, the burst list itself is only ever read
+            t->remCpu = t->bursts[n->currBurst].cpuTime;
+            t->remIo = t->bursts[n->currBurst].ioTime;
+        }
     }
 
     return num;
 }
 
-// Creates the DES Min heap and reads info in from STDIN
-heap* initializePriorityQueue(process*** p, int* processAmt, int* threadSwitch, int* processSwitch) {
+// Reads the processes from the input
+// The input is either a binary workload or the text format in README.md, the DES Min heap is built from them by heapFromProcesses
+bool loadWorkload(inputReader* in, arena* a, process** p, int* processAmt, runContext* ctx) {
+    return loadProcesses(in, a, p, processAmt, &(ctx->threadSwitch), &(ctx->processSwitch));
+}
+
+// Reads the processes from a binary workload or the text format in README.md
+bool loadProcesses(inputReader* in, arena* a, process** p, int* processAmt, int* threadSwitch, int* processSwitch) {
+    if(isBinaryWorkload(in)) {
+        if(!in->mapped) {
+            fprintf(stderr, "Binary workloads must be passed with -f.\n");
+            return false;
+        }
+        return mapBinaryWorkload(in, p, processAmt, threadSwitch, processSwitch);
+    }
+    return parseTextWorkload(in, a, p, processAmt, threadSwitch, processSwitch);
+}
+
+// Reads a text workload from the input
+// All processes, threads, and bursts are carved out of the arena
+bool parseTextWorkload(inputReader* in, arena* a, process** p, int* processAmt, int* threadSwitch, int* processSwitch) {
+    int vals[3];
+
     /* Error Checking */
-    if( scanf(" %d %d %d", processAmt, threadSwitch) != 3 || !validateLineEnding()) {
+    if( !readLine(in, vals, 3) || vals[0] < 0) {
         fprintf(stderr, "Error ingesting line 0 of input file.\n");
-        return NULL;
+        return false;
     }
+    *processAmt = vals[0];
+    *threadSwitch = vals[1];
+    *processSwitch = vals[2];
 
     /* Create process array */
-    *p = (process**)calloc(*processAmt, sizeof(process*));
+    *p = (process*)arenaAlloc(a, *processAmt * sizeof(process));
     int pNum;
     int tAmt;
     for(int i = 0; i < *processAmt; i++) { // Iterate through all processes to be added
-        process* newP = (process*)calloc(1, sizeof(process)); // Add new process to list
-        (*p)[i] = newP;
+        process* newP = &((*p)[i]); // Add new process to list
+        newP->threads = NULL;
+        newP->threadAmt = 0;
         
-        if( scanf(" %d %d", &pNum, &tAmt) != 2 || !validateLineEnding()) { // NULL checks sim info and attempts to ingest more info from stdin
+        int valAmt = readLineUpTo(in, vals, 2, 3); // Priority is optional
+        if( valAmt == -1 || vals[1] < 0) { // Attempts to ingest more info from the input
             fprintf(stderr, "Error ingesting process %d.\n", i+1);
-            return NULL;
+            return false;
         }
+        pNum = vals[0];
+        tAmt = vals[1];
 
         newP->threadAmt = tAmt; // Ingest threads from STDIN to this process
-        newP->threads = createThreadList( pNum, tAmt);
+        newP->threads = createThreadList(in, a, i, pNum, tAmt, (valAmt == 3) ? vals[2] : 0);
         if(newP->threads == NULL) { 
-            return NULL; 
+            return false; 
         }        
     }
 
-    /* Copy pointers from process array to heap */
-    heap* h = heapFromProcesses(*p, pNum);
-
-    return h;
+    return true;
 }
 
-// Creates a list of threads using data from stdin
-thread** createThreadList( int pNum, int tAmt ) {
-    thread** tList = (thread**)calloc(tAmt, sizeof(thread*));
+// Creates a list of threads using data from the input
+thread* createThreadList(inputReader* in, arena* a, int pIndex, int pNum, int tAmt, int priority) {
+    thread* tList = (thread*)arenaAlloc(a, tAmt * sizeof(thread));
     if(!tList) { return NULL; } // NULL Checks for failed malloc
 
     thread* newThread;
-    int tNo;
-    int arrTime;
-    int bNo;
+    int vals[3];
     for(int i = 0; i < tAmt; i++) { // Iterate through all threads to be added
-        newThread = createEmptyThread();  // Add new thread to list
-        tList[i] = newThread;
+        newThread = &(tList[i]);  // Add new thread to list
+        initializeThread(newThread);
         
-        if(!newThread || scanf(" %d %d %d", &tNo, &arrTime, &bNo) != 3  || !validateLineEnding()) { // NULL Checks thread and attempts to ingest more info from stdin
+        if(!readLine(in, vals, 3) || vals[2] <= 0) { // Attempts to ingest more info from the input, every thread needs a burst to run
             fprintf(stderr, "Error ingesting thread %d of process %d.\n", i+1, pNum);
-            freeThreads(tList, tAmt);
             return NULL;
         }
 
-        newThread->TNo = tNo; // Ingest bursts from STDIN to this thread
-        newThread->arrTime = arrTime;
-        newThread->burstNo = bNo;
+        newThread->TNo = vals[0]; // Ingest bursts from the input to this thread
+        newThread->arrTime = vals[1];
+        newThread->burstNo = vals[2];
         newThread->PNo = pNum;
-        newThread->bursts = createBurstList(newThread->burstNo, i+1);
+        newThread->processIndex = pIndex;
+        newThread->priority = priority;
+        newThread->bursts = createBurstList(in, a, newThread->burstNo, i+1);
         if(newThread->bursts == NULL) { 
-            freeThreads(tList, tAmt);
             return NULL; 
         }
-        
+        sumBurstTimes(newThread);
+        resetThread(newThread);
     }
 
     return tList;
 }
 
-// Creates a list of bursts using data from stdin
-cpuBurst** createBurstList(int bAmt, int tNum) {
-    cpuBurst** bList = (cpuBurst**)calloc(bAmt, sizeof(cpuBurst*));
+// Creates a list of bursts using data from the input
+cpuBurst* createBurstList(inputReader* in, arena* a, int bAmt, int tNum) {
+    cpuBurst* bList = (cpuBurst*)arenaAlloc(a, bAmt * sizeof(cpuBurst));
     if(!bList) { return NULL; } // NULL Checks for failed malloc
 
+    if(!readBursts(in, bList, bAmt, tNum)) {
+        return NULL;
+    }
+    return bList;
+}
+
+// Reads bAmt bursts from the input into bList
+bool readBursts(inputReader* in, cpuBurst* bList, int bAmt, int tNum) {
     cpuBurst* newBurst;
-    int burstNo;
-    int cpuTime;
-    int ioTime;
+    int vals[3]; // burst number, cpu time, io time
     for(int i = 0; i < bAmt ; i++) { // Iterate through n bursts to be added
-        newBurst = (cpuBurst*)malloc(1* sizeof(cpuBurst)); // Add new burst to list
-        bList[i] = newBurst;
+        newBurst = &(bList[i]); // Add new burst to list
 
         if(i == bAmt - 1) { // nth burst, no IO
-            if(!newBurst || scanf(" %d %d", &burstNo, &cpuTime) != 2 || !validateLineEnding()) { // NULL Checks burst and attempts to ingest more info from stdin
+            if(!readLine(in, vals, 2)) { // Attempts to ingest more info from the input
                 fprintf(stderr, "Error ingesting burst %d of thread %d.\n", bAmt, tNum);
-                freeBursts(bList, bAmt); // Frees burst list
-                return NULL;
+                return false;
             }   
-            newBurst->ioTime = 0;
+            vals[2] = 0;
         }
         else { // n - 1st burst, has IO
-            if(!newBurst || scanf(" %d %d %d", &burstNo, &cpuTime, &ioTime) != 3 || !validateLineEnding()) { // NULL Checks burst and attempts to ingest more info from stdin
+            if(!readLine(in, vals, 3)) { // Attempts to ingest more info from the input
                 fprintf(stderr, "Error ingesting burst %d of thread %d.\n", i+1, tNum);
-                freeBursts(bList, bAmt);
-                return NULL;
+                return false;
             }      
-            newBurst->ioTime = ioTime;
         }  
-        newBurst->burstNo = burstNo;
-        newBurst->cpuTime = cpuTime;
-        newBurst->currCpuTime = cpuTime;
-        newBurst->currIoTime = ioTime;
+        newBurst->cpuTime = vals[1];
+        newBurst->ioTime = vals[2];
     }
 
-    return bList;
+    return true;
 }
 
-// Initializes an empty thread and returns it
-thread* createEmptyThread() {
-    thread* newThread;
-    newThread = (thread*)malloc(sizeof(thread));
-    if(!newThread) { return NULL; } // NULL Check for failed malloc
-    newThread->PNo = -1;
-    newThread->TNo = -1;
-    newThread->arrTime = -1; // Arrival Time
-    newThread->finTime = -1; // Finish Time
-    newThread->bursts = NULL;
-    newThread->s = NEW;
-
-    return newThread;
+// Initializes an empty thread in place
+void initializeThread(thread* t) {
+    t->PNo = -1;
+    t->TNo = -1;
+    t->arrTime = -1; // Arrival Time
+    t->finTime = -1; // Finish Time
+    t->burstNo = 0;
+    t->remCpu = 0;
+    t->remIo = 0;
+    t->lastCore = -1;
+    t->processIndex = -1;
+    t->priority = 0;
+    t->level = 0;
+    t->serviceTime = 0;
+    t->ioTime = 0;
+    t->bursts = NULL;
+    t->s = NEW;
 }
 
 // Prints out a list of processes and their thread info.
 // Used when printing stats
-void printProcesses(process** processes, int processAmt) {
+void printProcesses(process* processes, int processAmt) {
     if (processes != NULL) {
+        traceSink* s = openTrace(stdout, true); // Same lines as printThreads, without formatting each one with printf
         for(int i = 0; i < processAmt; i++) {
-            if(processes[i] != NULL)
-                printThreads(processes[i]->threads, processes[i]->threadAmt);
+            for(int j = 0; j < processes[i].threadAmt; j++) {
+                traceThread(s, &(processes[i].threads[j]));
+            }
         }
+        closeTrace(s);
     }   
     else {
         printf("No Processes Provided.\n");
@@ -312,12 +994,10 @@ void printThread(thread* t) {
 
 // Prints out a list of threads and their info
 // Used when printing stats
-void printThreads(thread** threads, int threadAmt) {
-    thread* currThread;
+void printThreads(thread* threads, int threadAmt) {
     if(threads != NULL) {
         for(int i = 0; i < threadAmt; i++) {
-            if(threads[i] != NULL)
-                printThread(threads[i]);
+            printThread(&(threads[i]));
         }
     }  
     else {
@@ -325,32 +1005,28 @@ void printThreads(thread** threads, int threadAmt) {
     }
 }
 
-// Calculate the total amount of IO time a thread needs
+// Get the total amount of IO time a thread needs
 // Used when printing stats
 int getTotalIOTime(thread* t) {
-    int sum = 0;
-    if ( t != NULL ) {
-        for(int i = 0; i < t->burstNo - 1; i++) {
-            sum+= t->bursts[i]->ioTime;
-        }
-        return sum;
-    }
-    else
-        return sum;
+    return (t != NULL) ? t->ioTime : 0;
 }
 
-// Calculate the total amount of cpu time a thread needs
+// Get the total amount of cpu time a thread needs
 // Used when printing stats
 int getTotalServiceTime(thread* t) {
-    int sum = 0;
-    if ( t != NULL ) {
-        for(int i = 0; i < t->burstNo; i++) {
-            sum+= t->bursts[i]->cpuTime;
-        }
-        return sum;
+    return (t != NULL) ? t->serviceTime : 0;
+}
+
+// Sums the CPU and IO time of every burst once when the thread is loaded
+// The last burst has no IO
+void sumBurstTimes(thread* t) {
+    t->serviceTime = 0;
+    t->ioTime = 0;
+    for(int i = 0; i < t->burstNo; i++) {
+        t->serviceTime += t->bursts[i].cpuTime;
+        if(i < t->burstNo - 1)
+            t->ioTime += t->bursts[i].ioTime;
     }
-    else
-        return sum;
 }
 
 // Calculate a threads turnaround time
@@ -362,212 +1038,970 @@ int getTurnaroundTime(thread* t) {
     return -1;
 }
 
-// Calculate the average turnaround time for all processes (NOT THREADS)
-// Used when printing stats
-float getAverageTurnaroundTime(process** processes, int processAmt) {
-    float avgTime = 0;
-    int processStartTime;
-    int processEndTime;
-    thread** tList;
-    if(processes != NULL) {
-        for(int i = 0; i < processAmt; i++) { // Iterate through each process
-            processStartTime = 0;
-            processEndTime = 0;
-            tList = processes[i]->threads;
-            for(int j = 0; j < processes[i]->threadAmt; j++) { // Iterate through each thread
-                processStartTime = min(processStartTime, tList[j]->arrTime); // Find the minimum start time for a thread in this process
-                processEndTime = max(processEndTime, tList[j]->finTime); // Find the maximum end time for a thread in this process
-
-            }
-            avgTime += processEndTime - processStartTime; // Add the turnaround time for this process
-        }
-
-        avgTime /= processAmt; // Divide by amt of processes
+// Copies every process and thread into the arena, the copies point at the same read-only bursts
+// Used to give each sweep worker its own threads to run
+process* cloneProcesses(arena* a, process* p, int processAmt) {
+    process* copy = (process*)arenaAlloc(a, processAmt * sizeof(process));
+    for(int i = 0; i < processAmt; i++) {
+        copy[i].threadAmt = p[i].threadAmt;
+        copy[i].threads = (thread*)arenaAlloc(a, p[i].threadAmt * sizeof(thread));
+        memcpy(copy[i].threads, p[i].threads, p[i].threadAmt * sizeof(thread));
     }
-    return avgTime;
+    return copy;
 }
 
-// Frees a list of processes
-void freeProcesses(process*** processes, int processAmt) {
-    if(*processes != NULL) {
-        for( int i = 0; i < processAmt; i++) {
-            if((*processes)[i] != NULL) {
-                freeThreads((*processes)[i]->threads, (*processes)[i]->threadAmt);
-                free( (*processes)[i] );
-            }
+// Puts every thread back in the new state at the start of its first burst
+// Lets the same threads be simulated again without reparsing, only the threads are touched
+void resetProcesses(process* p, int processAmt) {
+    for(int i = 0; i < processAmt; i++) {
+        for(int j = 0; j < p[i].threadAmt; j++) {
+            resetThread(&(p[i].threads[j]));
         }
-        free(*processes);
     }
-    free(processes);
 }
 
+// Puts t back in the new state and loads its first burst
+void resetThread(thread* t) {
+    t->s = NEW;
+    t->finTime = -1;
+    t->lastCore = -1;
+    t->level = 0;
+    t->remCpu = (t->burstNo > 0) ? t->bursts[0].cpuTime : 0;
+    t->remIo = (t->burstNo > 0) ? t->bursts[0].ioTime : 0;
+}
+
+/* BINARY WORKLOAD FUNCTIONS */
 
-// Frees a list of threads
-void freeThreads( thread** threads, int threadAmt) {
-    if(threads != NULL) {
-        for( int i = 0; i < threadAmt; i++) {
-            if(threads[i] != NULL) {
-                freeBursts(threads[i]->bursts, threads[i]->burstNo);
-                free( threads[i]);
-            }
-        }
-        free(threads);
+// Checks whether the input starts with the binary workload magic
+bool isBinaryWorkload(inputReader* in) {
+    if(peekInput(in) == EOF || in->len - in->pos < sizeof(WORKLOAD_MAGIC) - 1) {
+        return false;
     }
+    return memcmp(in->buf + in->pos, WORKLOAD_MAGIC, sizeof(WORKLOAD_MAGIC) - 1) == 0;
 }
 
-// Frees a list of bursts
-void freeBursts(cpuBurst** bursts, int burstAmt) {
-    if(bursts != NULL) {
-        for( int i = 0; i < burstAmt; i++) {
-            if(bursts[i] != NULL) {
-                free( bursts[i]);
+// Points the process, thread, and burst views straight into a mapped binary workload
+// Only the process and thread tables are touched, to turn their stored offsets back into pointers and reset the threads
+// The burst table is only ever read, so its pages stay shared with the page cache
+bool mapBinaryWorkload(inputReader* in, process** p, int* processAmt, int* threadSwitch, int* processSwitch) {
+    workloadHeader* header = (workloadHeader*)in->buf;
+    char* base = in->buf;
+    size_t len = in->len;
+
+    if(len < sizeof(workloadHeader) || header->version != WORKLOAD_VERSION || header->processSize != sizeof(process) 
+    || header->threadSize != sizeof(thread) || header->burstSize != sizeof(cpuBurst)) {
+        fprintf(stderr, "Error ingesting binary workload: unsupported version or layout.\n");
+        return false;
+    }
+    if(!tableFits(header->burstTable, header->burstAmt, sizeof(cpuBurst), (long long)len)
+    || !tableFits(header->threadTable, header->threadAmt, sizeof(thread), header->burstTable) // Threads end where the bursts start
+    || !tableFits(header->processTable, header->processAmt, sizeof(process), (long long)len)) {
+        fprintf(stderr, "Error ingesting binary workload: file is truncated.\n");
+        return false;
+    }
+
+    *processAmt = header->processAmt;
+    *threadSwitch = header->threadSwitch;
+    *processSwitch = header->processSwitch;
+    *p = (process*)(base + header->processTable);
+
+    size_t offset;
+    for(int i = 0; i < *processAmt; i++) {
+        offset = (size_t)((*p)[i].threads);
+        if(offset < (size_t)header->threadTable || !tableFits((long long)offset, (*p)[i].threadAmt, sizeof(thread), header->burstTable)) {
+            fprintf(stderr, "Error ingesting binary workload: process %d is out of bounds.\n", i+1);
+            return false;
+        }
+        (*p)[i].threads = (thread*)(base + offset);
+        for(int j = 0; j < (*p)[i].threadAmt; j++) {
+            offset = (size_t)((*p)[i].threads[j].bursts);
+            if(offset < (size_t)header->burstTable || (*p)[i].threads[j].burstNo <= 0 // Every thread needs a burst to run
+            || !tableFits((long long)offset, (*p)[i].threads[j].burstNo, sizeof(cpuBurst), (long long)len)) {
+                fprintf(stderr, "Error ingesting binary workload: thread %d of process %d is out of bounds.\n", j+1, i+1);
+                return false;
             }
+            (*p)[i].threads[j].bursts = (cpuBurst*)(base + offset);
+            resetThread(&((*p)[i].threads[j])); // Scheduling state, whatever the file holds here is stale
+            (*p)[i].threads[j].processIndex = i; // Indexes per process arrays, so the file's copy is never trusted
         }
-        free(bursts);
     }
-}
 
-// Validates that new line is present at the end of the stdin line
-bool validateLineEnding() {
-    char tempchar;
-    while( (tempchar = getc(stdin)) == ' '); // get rid of whitespace
-    return (tempchar == '\n' || tempchar == '\0' || tempchar == EOF); // Checks final character for new line
+    return true;
 }
 
-/* HEAP FUNCTIONS */
+// Checks that count records of size bytes starting at offset end at or before limit
+// Offsets and counts come straight from the file, so negative values are rejected and the end is never computed where it could overflow
+bool tableFits(long long offset, long long count, size_t size, long long limit) {
+    return offset >= 0 && count >= 0 && offset <= limit && count <= (limit - offset) / (long long)size;
+}
 
-// Checks if the heap is empty
-bool isEmpty(heap* h) {
-    if(h == NULL) {
-        return true;
+// Writes a workload in the binary format, threads and bursts are reset to their unsimulated state
+// Returns false if the file could not be written
+bool writeBinaryWorkload(char* path, process* p, int processAmt, int threadSwitch, int processSwitch) {
+    FILE* out = fopen(path, "wb");
+    if(!out) { return false; }
+
+    workloadHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, WORKLOAD_MAGIC, sizeof(header.magic));
+    header.version = WORKLOAD_VERSION;
+    header.processAmt = processAmt;
+    header.threadSwitch = threadSwitch;
+    header.processSwitch = processSwitch;
+    header.processSize = sizeof(process);
+    header.threadSize = sizeof(thread);
+    header.burstSize = sizeof(cpuBurst);
+    for(int i = 0; i < processAmt; i++) {
+        header.threadAmt += p[i].threadAmt;
+        for(int j = 0; j < p[i].threadAmt; j++) {
+            header.burstAmt += p[i].threads[j].burstNo;
+        }
+    }
+    header.processTable = sizeof(workloadHeader);
+    header.threadTable = header.processTable + processAmt * sizeof(process);
+    header.burstTable = header.threadTable + header.threadAmt * sizeof(thread);
+    fwrite(&header, sizeof(header), 1, out);
+
+    // Process table
+    size_t threadOffset = header.threadTable;
+    process newP;
+    for(int i = 0; i < processAmt; i++) {
+        newP = p[i];
+        newP.threads = (thread*)threadOffset;
+        fwrite(&newP, sizeof(process), 1, out);
+        threadOffset += p[i].threadAmt * sizeof(thread);
     }
-    return h->curr_size == 0;
-}
 
-// Ingests a list of processes into a new DES Min Heap
-heap* heapFromProcesses(process** pList, int pNum) {
-    // Create a new heap
-    heap* h;
-    h = (heap*)malloc(sizeof(heap));
-    h->curr_size = 0;
+    // Thread table
+    size_t burstOffset = header.burstTable;
+    thread newThread;
+    for(int i = 0; i < processAmt; i++) {
+        for(int j = 0; j < p[i].threadAmt; j++) {
+            newThread = p[i].threads[j];
+            newThread.bursts = p[i].threads[j].bursts;
+            resetThread(&newThread);
+            newThread.bursts = (cpuBurst*)burstOffset;
+            fwrite(&newThread, sizeof(thread), 1, out);
+            burstOffset += newThread.burstNo * sizeof(cpuBurst);
+        }
+    }
 
-    // Ingest data from array into heap
-    for(int i = 0; i < pNum; i++) {
-        for(int j = 0; j < pList[i]->threadAmt; j++) {
-            insertItem(h, pList[i]->threads[j]->arrTime, pList[i]->threads[j], 0);
+    // Burst table
+    for(int i = 0; i < processAmt; i++) {
+        for(int j = 0; j < p[i].threadAmt; j++) {
+            fwrite(p[i].threads[j].bursts, sizeof(cpuBurst), p[i].threads[j].burstNo, out);
         }
     }
 
-    return h;
+    bool written = !ferror(out);
+    return (fclose(out) == 0) && written;
 }
 
-// Inserts a node with key, data, curr burst, and event, into the heap
-void insertItem(heap* h, int key, void* data, int currBurst) {
-    // Create new node
-    node* newNode = (node*)malloc(sizeof(node));
-    newNode->currBurst = currBurst;
-    newNode->key = key;
-    newNode->data = data;
+/* STREAMING FUNCTIONS */
 
-    // Add node to heap
-    h->curr_size++;
-    if(h->curr_size <= 1) { // no nodes in heap yet
-        h->harr = (node**)malloc(h->curr_size * sizeof(node*));
-        (h->harr)[0] = newNode;
+// Starts reading a text workload whose threads are sorted by arrival time
+// Only the first line and the first thread are read, returns NULL if either is malformed
+arrivalStream* openArrivalStream(inputReader* in, int* threadSwitch, int* processSwitch) {
+    int vals[3];
+    if(isBinaryWorkload(in)) {
+        fprintf(stderr, "Binary workloads can't be streamed.\n");
+        return NULL;
     }
-    else { // Nodes present in heap
-        h->harr = (node**)realloc(h->harr, h->curr_size * sizeof(node*)); // Make space for another node
-        (h->harr)[h->curr_size-1] = newNode; // Set last node to new node
-        upheap(h, h->curr_size-1); // Restore heap balance
+    if( !readLine(in, vals, 3) || vals[0] < 0) {
+        fprintf(stderr, "Error ingesting line 0 of input file.\n");
+        return NULL;
+    }
+    *threadSwitch = vals[1];
+    *processSwitch = vals[2];
+
+    arrivalStream* s = (arrivalStream*)malloc(sizeof(arrivalStream));
+    s->in = in;
+    s->processAmt = vals[0];
+    s->processesRead = 0;
+    s->pNum = -1;
+    s->threadsRead = 0;
+    s->threadAmt = 0;
+    s->arrivalNo = 0;
+    s->failed = false;
+    s->next = readStreamThread(s);
+    if(s->failed) {
+        closeArrivalStream(s);
+        return NULL;
     }
+
+    return s;
 }
 
-// Removes the minimum node from the heap
-// Returned value must be freed by the caller
-node* removeMin(heap* h) {
-    node* topNode;
-    if(h != NULL && h->curr_size > 0) {
-        topNode = minElement(h);
-        (h->harr)[0] = NULL; // Remove the pointer from the heap
-        swapNodes( &((h->harr)[0]), &((h->harr)[h->curr_size-1]) ); // Swap root node with last node
+// Reads the next thread and its bursts into their own allocation
+// Sets failed and returns NULL if the input is malformed or not sorted by arrival time
+thread* readStreamThread(arrivalStream* s) {
+    int vals[3];
+    while(s->threadsRead == s->threadAmt) { // Current process is done, move to the next one
+        if(s->processesRead == s->processAmt) {
+            return NULL;
+        }
+        int valAmt = readLineUpTo(s->in, vals, 2, 3); // Priority is optional
+        if( valAmt == -1 || vals[1] < 0) {
+            fprintf(stderr, "Error ingesting process %d.\n", s->processesRead+1);
+            s->failed = true;
+            return NULL;
+        }
+        s->processesRead++;
+        s->pNum = vals[0];
+        s->threadAmt = vals[1];
+        s->priority = (valAmt == 3) ? vals[2] : 0;
+        s->threadsRead = 0;
+    }
 
-        h->curr_size--; // Reallocate heap
-        h->harr = (node**)realloc(h->harr, h->curr_size * sizeof(node*));
+    s->threadsRead++;
+    if(!readLine(s->in, vals, 3) || vals[2] <= 0) { // Every thread needs a burst to run
+        fprintf(stderr, "Error ingesting thread %d of process %d.\n", s->threadsRead, s->pNum);
+        s->failed = true;
+        return NULL;
+    }
+    if(s->next != NULL && vals[1] < s->next->arrTime) {
+        fprintf(stderr, "Error ingesting thread %d of process %d: streamed input must be sorted by arrival time.\n", s->threadsRead, s->pNum);
+        s->failed = true;
+        return NULL;
+    }
 
-        downheap(h, 0); // Rebalance heap
+    streamedThread* st = (streamedThread*)malloc(sizeof(streamedThread) + vals[2] * sizeof(cpuBurst));
+    thread* t = &(st->t);
+    initializeThread(t);
+    t->TNo = vals[0];
+    t->arrTime = vals[1];
+    t->burstNo = vals[2];
+    t->PNo = s->pNum;
+    t->priority = s->priority;
+    t->bursts = st->bursts;
+    t->processIndex = s->processesRead - 1;
+    if(!readBursts(s->in, st->bursts, t->burstNo, s->threadsRead)) {
+        free(st);
+        s->failed = true;
+        return NULL;
     }
+    sumBurstTimes(t);
+    resetThread(t);
 
-    return topNode;
-    
+    return t;
 }
 
-// Rebalances heap after inserting
-void upheap(heap* h, int i) {
-    thread* t1;
-    thread* t2;
-    
-    int currIndex;
-    int parentIndex = getParentIndex(i);
-    if( (h->harr)[parentIndex]->key > (h->harr)[i]->key ) { // left node is greater than current node
-        swapNodes( &((h->harr)[parentIndex]), &((h->harr)[i]) );
-        upheap(h, parentIndex);
+// Hands every thread that arrives at or before time to the event queue
+void feedArrivals(arrivalStream* s, heap* h, int time) {
+    while(s->next != NULL && s->next->arrTime <= time) {
+        if(s->arrivalNo >= EVENT_SEQ_BIT) // Every 31 bit arrival number has been handed out
+            s->arrivalNo = renumberSeqs(h, EVENT_SEQ_BIT, 0);
+        insertArrival(h, s->next, s->arrivalNo++);
+        s->next = readStreamThread(s);
     }
 }
 
-// Rebalances heap after removing
-void downheap(heap* h, int i) {
-    node* n1;
-    node* n2;
-    thread* t1;
-    thread* t2;
-    
-    int min;
-    int rightIndex= getRightIndex(i);
-    int leftIndex = getLeftIndex(i);
-
-    if(h->curr_size <= 1) {
-        return;
+// Frees a terminated thread, its statistics were already recorded
+void releaseStreamThread(arrivalStream* s, thread* t) {
+    (void)s;
+    free((streamedThread*)t);
+}
+
+// Frees the stream and the thread it read ahead
+// Threads still in the simulation are not freed
+void closeArrivalStream(arrivalStream* s) {
+    if(s != NULL) {
+        if(s->next != NULL)
+            free(s->next);
+        free(s);
+    }
+}
+
+/* SWEEP FUNCTIONS */
+
+// Parses a sweep range of the form param=lo..hi or param=lo..hi:step into range (lo, hi, step)
+// range may be NULL to only validate arg, returns the swept parameter or -1 if arg is malformed
+int parseSweepRange(char* arg, int* range) {
+    char* names[SWEEP_PARAMS] = {"quantum", "threadswitch", "processswitch"};
+    int param = -1;
+    int lo, hi;
+    int step = 1;
+    int used = 0;
+    for(int i = 0; i < SWEEP_PARAMS && param == -1; i++) {
+        size_t len = strlen(names[i]);
+        if(strncmp(arg, names[i], len) == 0 && arg[len] == '=')
+            param = i;
+    }
+    if(param == -1) {
+        return -1;
+    }
+
+    char* r = strchr(arg, '=') + 1;
+    if(sscanf(r, "%d..%d%n", &lo, &hi, &used) != 2) {
+        return -1;
+    }
+    r += used;
+    if(*r == ':' && sscanf(r + 1, "%d%n", &step, &used) == 1) { // Optional step
+        r += used + 1;
+    }
+    if(*r != '\0' || lo < 0 || hi < lo || step <= 0) {
+        return -1;
+    }
+
+    if(range != NULL) {
+        range[0] = lo;
+        range[1] = hi;
+        range[2] = step;
+    }
+    return param;
+}
+
+// Builds one run for every combination of the swept parameters, unswept parameters keep base's value
+// A quantum of 0 is run as FCFS, must be freed by caller
+runContext* buildSweepRuns(runContext* base, int ranges[SWEEP_PARAMS][3], bool* swept, int* runAmt) {
+    int baseValues[SWEEP_PARAMS] = {base->RRTime, base->threadSwitch, base->processSwitch};
+    int counts[SWEEP_PARAMS];
+    *runAmt = 1;
+    for(int i = 0; i < SWEEP_PARAMS; i++) {
+        if(!swept[i]) { // Only the base value
+            ranges[i][0] = baseValues[i];
+            ranges[i][1] = baseValues[i];
+            ranges[i][2] = 1;
+        }
+        counts[i] = (ranges[i][1] - ranges[i][0]) / ranges[i][2] + 1;
+        *runAmt *= counts[i];
+    }
+
+    runContext* runs = (runContext*)malloc(*runAmt * sizeof(runContext));
+    for(int r = 0; r < *runAmt; r++) {
+        int rest = r;
+        int values[SWEEP_PARAMS];
+        for(int i = SWEEP_PARAMS - 1; i >= 0; i--) { // Last parameter changes fastest
+            values[i] = ranges[i][0] + (rest % counts[i]) * ranges[i][2];
+            rest /= counts[i];
+        }
+        runs[r] = *base;
+        runs[r].RRTime = values[SWEEP_QUANTUM];
+        runs[r].threadSwitch = values[SWEEP_THREAD_SWITCH];
+        runs[r].processSwitch = values[SWEEP_PROCESS_SWITCH];
+    }
+    return runs;
+}
+
+// Runs sweep configurations until there are none left
+// Every worker simulates its own copy of the threads and bursts, so runs don't share any mutable state
+void* sweepWorker(void* arg) {
+    sweep* s = (sweep*)arg;
+    arena* a = initializeArena();
+    process* p = cloneProcesses(a, s->processes, s->processAmt);
+
+    int i;
+    while((i = __sync_fetch_and_add(&(s->nextRun), 1)) < s->runAmt) {
+        runContext* ctx = &(s->runs[i]);
+        resetProcesses(p, s->processAmt);
+        heap* h = heapFromProcesses(p, s->processAmt, ctx->eventQueueType);
+        core* cores = initializeCores(ctx);
+        runSimulation(ctx, h, cores, NULL, s->processAmt);
+        freeCores(ctx, cores);
+        freeHeap(h);
+    }
+
+    freeArena(a);
+    return NULL;
+}
+
+// Runs every configuration of the sweep on up to workerAmt threads
+// Returns false if no worker could be started
+bool runSweep(sweep* s, int workerAmt) {
+    workerAmt = max(1, min(workerAmt, s->runAmt));
+    pthread_t* workers = (pthread_t*)malloc(workerAmt * sizeof(pthread_t));
+    int started = 0;
+    for(int i = 0; i < workerAmt; i++) {
+        if(pthread_create(&(workers[started]), NULL, sweepWorker, s) == 0)
+            started++;
+    }
+    for(int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+    return started > 0;
+}
+
+// Prints one row of statistics per sweep configuration
+void printSweepResults(sweep* s) {
+    runContext* ctx;
+    float util;
+    printf("------------------------------------------------------------\n");
+    printf("Parameter Sweep (%d runs)\n", s->runAmt);
+    printf("%8s %14s %15s %11s %15s %9s\n", "Quantum", "Thread Switch", "Process Switch", "Total Time", "Avg Turnaround", "CPU Util");
+    for(int i = 0; i < s->runAmt; i++) {
+        ctx = &(s->runs[i]);
+        util = (ctx->totalTime != 0) ? ((float)ctx->busyTime / ((float)ctx->totalTime * ctx->coreAmt)) * 100 : 0;
+        if(ctx->RRTime == 0)
+            printf("%8s ", "FCFS");
+        else
+            printf("%8d ", ctx->RRTime);
+        printf("%14d %15d %11d %15.1f %8.1f%%\n", ctx->threadSwitch, ctx->processSwitch, ctx->totalTime, ctx->avgTurnaround, util);
+    }
+    printf("------------------------------------------------------------\n");
+}
+
+/* PARTITION FUNCTIONS */
+
+// Pins each process to the core with the least CPU time pinned so far, in input order
+// Returns the core of every process by processIndex
+int* assignPartitions(process* p, int processAmt, int coreAmt) {
+    int* processCore = (int*)malloc((processAmt + 1) * sizeof(int));
+    long long* load = (long long*)calloc(coreAmt, sizeof(long long));
+    for(int i = 0; i < processAmt; i++) {
+        long long work = 0;
+        for(int j = 0; j < p[i].threadAmt; j++) {
+            work += p[i].threads[j].serviceTime;
+        }
+        int lightest = 0;
+        for(int c = 1; c < coreAmt; c++) {
+            if(load[c] < load[lightest])
+                lightest = c;
+        }
+        processCore[i] = lightest;
+        load[lightest] += work;
+    }
+    free(load);
+    return processCore;
+}
+
+// Simulates every core of a partitioned run on its own, on up to workerAmt threads
+// Each core's threads only ever meet each other, so its run is the same as its part of the shared event loop
+// Fills ctx's results and each core's busy time as runSimulation would, returns false if no worker could be started
+bool runPartitions(runContext* ctx, process* p, int processAmt, core* cores, int workerAmt) {
+    partitionSet s = { .partitionAmt = ctx->coreAmt, .processAmt = processAmt, .nextPartition = 0 };
+
+    // Group the processes by core, keeping their input order so arrivals at the same time are still taken in that order
+    s.processes = (process*)malloc((processAmt + 1) * sizeof(process));
+    s.first = (int*)calloc(s.partitionAmt + 1, sizeof(int));
+    for(int i = 0; i < processAmt; i++) {
+        s.first[ctx->processCore[i] + 1]++;
+    }
+    for(int c = 0; c < s.partitionAmt; c++) {
+        s.first[c + 1] += s.first[c];
+    }
+    int* next = (int*)malloc(s.partitionAmt * sizeof(int));
+    memcpy(next, s.first, s.partitionAmt * sizeof(int));
+    for(int i = 0; i < processAmt; i++) {
+        s.processes[next[ctx->processCore[i]]++] = p[i];
+    }
+    free(next);
+
+    s.runs = (runContext*)malloc(s.partitionAmt * sizeof(runContext));
+    for(int c = 0; c < s.partitionAmt; c++) {
+        s.runs[c] = *ctx;
+        s.runs[c].coreAmt = 1;
+        s.runs[c].processCore = NULL;
+    }
+
+    workerAmt = max(1, min(workerAmt, s.partitionAmt));
+    pthread_t* workers = (pthread_t*)malloc(workerAmt * sizeof(pthread_t));
+    int started = 0;
+    for(int i = 0; i < workerAmt; i++) {
+        if(pthread_create(&(workers[started]), NULL, partitionWorker, &s) == 0)
+            started++;
+    }
+    for(int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+
+    if(started > 0) {
+        ctx->totalTime = 0;
+        ctx->busyTime = 0;
+        ctx->eventAmt = 0;
+        initializeMetrics(&(ctx->metrics), processAmt);
+        for(int c = 0; c < s.partitionAmt; c++) {
+            ctx->totalTime = max(ctx->totalTime, s.runs[c].totalTime);
+            ctx->busyTime += s.runs[c].busyTime;
+            ctx->eventAmt += s.runs[c].eventAmt;
+            cores[c].busyTime = s.runs[c].busyTime;
+            mergeMetrics(&(ctx->metrics), &(s.runs[c].metrics));
+        }
+        finishMetrics(ctx);
+    }
+    free(s.runs);
+    free(s.first);
+    free(s.processes);
+    return started > 0;
+}
+
+// Runs partitions until there are none left
+void* partitionWorker(void* arg) {
+    partitionSet* s = (partitionSet*)arg;
+    int c;
+    while((c = __sync_fetch_and_add(&(s->nextPartition), 1)) < s->partitionAmt) {
+        runContext* ctx = &(s->runs[c]);
+        heap* h = heapFromProcesses(&(s->processes[s->first[c]]), s->first[c + 1] - s->first[c], ctx->eventQueueType);
+        core* cores = initializeCores(ctx);
+        runSimulation(ctx, h, cores, NULL, s->processAmt);
+        freeCores(ctx, cores);
+        freeHeap(h);
+    }
+    return NULL;
+}
+
+/* ARENA FUNCTIONS */
+
+// Allocates an empty arena, blocks are added as it fills
+// Must be freed by caller
+arena* initializeArena() {
+    arena* a = (arena*)malloc(sizeof(arena));
+    a->head = NULL;
+    return a;
+}
+
+// Returns size bytes of 8 byte aligned storage carved from the current block
+// Starts a new block when the current one is full, returns NULL on failed malloc
+void* arenaAlloc(arena* a, size_t size) {
+    size = (size + 7) & ~((size_t)7);
+    if(a->head == NULL || a->head->used + size > a->head->size) { // Current block is full
+        size_t blockSize = (size > ARENA_BLOCK_SIZE) ? size : ARENA_BLOCK_SIZE;
+        arenaBlock* block = (arenaBlock*)malloc(sizeof(arenaBlock) + blockSize);
+        if(!block) { return NULL; }
+        block->next = a->head;
+        block->used = 0;
+        block->size = blockSize;
+        a->head = block;
+    }
+
+    void* ptr = a->head->data + a->head->used;
+    a->head->used += size;
+    return ptr;
+}
+
+// Frees an arena and everything carved out of it
+void freeArena(arena* a) {
+    arenaBlock* next;
+    if(a != NULL) {
+        for(arenaBlock* block = a->head; block != NULL; block = next) {
+            next = block->next;
+            free(block);
+        }
+        free(a);
+    }
+}
+
+// Validates that new line is present at the end of the input line
+bool validateLineEnding(inputReader* in) {
+    int tempchar;
+    while( (tempchar = peekInput(in)) == ' ') { in->pos++; } // get rid of whitespace
+    if(tempchar != EOF) { in->pos++; }
+    return (tempchar == '\n' || tempchar == '\0' || tempchar == EOF); // Checks final character for new line
+}
+
+/* INPUT FUNCTIONS */
+
+// Opens the simulation input
+// A file path is mapped whole, stdin (path is NULL) or an unmappable file is read INPUT_BLOCK_SIZE bytes at a time
+// Returns NULL if the file can't be opened, must be closed by caller
+inputReader* openInput(char* path) {
+    struct stat st;
+    int fd = (path == NULL) ? STDIN_FILENO : open(path, O_RDONLY);
+    if(fd < 0) { return NULL; }
+
+    inputReader* in = (inputReader*)malloc(sizeof(inputReader));
+    in->len = 0;
+    in->pos = 0;
+    in->fd = fd;
+    in->mapped = false;
+    if(path != NULL && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) { // Regular file, map it
+        in->buf = (char*)mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0); // Writes stay private, binary workloads are simulated in place
+        if(in->buf != MAP_FAILED) {
+            madvise(in->buf, st.st_size, MADV_SEQUENTIAL);
+            in->len = st.st_size;
+            in->mapped = true;
+            return in;
+        }
+    }
+    in->buf = (char*)malloc(INPUT_BLOCK_SIZE);
+
+    return in;
+}
+
+// Replaces the buffer with the next block of input
+// Returns false if there is nothing left to read
+bool refillInput(inputReader* in) {
+    if(in->mapped) { return false; }
+
+    ssize_t amt;
+    do {
+        amt = read(in->fd, in->buf, INPUT_BLOCK_SIZE);
+    } while(amt < 0 && errno == EINTR);
+    in->pos = 0;
+    in->len = (amt > 0) ? amt : 0;
+
+    return in->len > 0;
+}
+
+// Returns the next character of the input without consuming it
+int peekInput(inputReader* in) {
+    if(in->pos == in->len && !refillInput(in)) {
+        return EOF;
+    }
+    return (unsigned char)in->buf[in->pos];
+}
+
+// Skips leading whitespace and reads a signed decimal integer
+// Returns false if there are no digits before the next non-whitespace character
+bool readInt(inputReader* in, int* out) {
+    int c;
+    int num = 0;
+    bool negative = false;
+    bool digits = false;
+
+    while( (c = peekInput(in)) == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f') { in->pos++; }
+    if(c == '-' || c == '+') {
+        negative = (c == '-');
+        in->pos++;
+    }
+    while( (c = peekInput(in)) >= '0' && c <= '9') {
+        num = num * 10 + (c - '0');
+        digits = true;
+        in->pos++;
+    }
+    *out = negative ? -num : num;
+
+    return digits;
+}
+
+// Reads amt integers from the current line into vals and checks that nothing else follows them
+// Reads at least minAmt and at most maxAmt integers from the rest of the line then validates the line ending
+// Returns how many were read, or -1 if the line is malformed
+int readLineUpTo(inputReader* in, int* vals, int minAmt, int maxAmt) {
+    int amt = 0;
+    int c;
+    for(; amt < minAmt; amt++) {
+        if(!readInt(in, &(vals[amt]))) {
+            return -1;
+        }
+    }
+    while(amt < maxAmt) { // Optional values must be on the same line
+        while( (c = peekInput(in)) == ' ' || c == '\t') { in->pos++; }
+        if(c != '-' && c != '+' && (c < '0' || c > '9'))
+            break;
+        if(!readInt(in, &(vals[amt]))) {
+            return -1;
+        }
+        amt++;
+    }
+    return validateLineEnding(in) ? amt : -1;
+}
+
+bool readLine(inputReader* in, int* vals, int amt) {
+    for(int i = 0; i < amt; i++) {
+        if(!readInt(in, &(vals[i]))) {
+            return false;
+        }
+    }
+    return validateLineEnding(in);
+}
+
+// Copies the next line into line without its newline, cutting it off at cap - 1 characters
+// Returns false if the input has no more lines
+bool readRawLine(inputReader* in, char* line, int cap) {
+    int len = 0;
+    bool any = false;
+    while(in->pos < in->len || refillInput(in)) {
+        char* start = in->buf + in->pos;
+        size_t avail = in->len - in->pos;
+        char* newline = (char*)memchr(start, '\n', avail);
+        size_t amt = (newline != NULL) ? (size_t)(newline - start) : avail;
+        size_t room = (size_t)(cap - 1 - len);
+        size_t copy = (amt < room) ? amt : room;
+        memcpy(line + len, start, copy);
+        len += copy;
+        in->pos += amt;
+        any = true;
+        if(newline != NULL) {
+            in->pos++;
+            break;
+        }
+    }
+    line[len] = '\0';
+    return any;
+}
+
+// Unmaps or frees the input buffer and closes the input file
+void closeInput(inputReader* in) {
+    if(in != NULL) {
+        if(in->mapped)
+            munmap(in->buf, in->len);
+        else
+            free(in->buf);
+        if(in->fd != STDIN_FILENO)
+            close(in->fd);
+        free(in);
+    }
+}
+
+/* HEAP FUNCTIONS */
+
+// Checks if the heap is empty
+bool isEmpty(heap* h) {
+    if(h == NULL) {
+        return true;
+    }
+    return h->curr_size == 0 && (h->wheel == NULL || h->wheel->curr_size == 0);
+}
+
+// Allocates an empty heap with room for capacity nodes
+// A WHEEL_QUEUE also gets a timing wheel in front of the heap
+// Must be freed by caller
+heap* initializeHeap(int capacity, queueType type) {
+    heap* h;
+    void* keys;
+    h = (heap*)malloc(sizeof(heap));
+    if(!h) { return NULL; } // NULL Checks for failed malloc
+    h->curr_size = 0;
+    h->nextSeq = 0;
+    h->capacity = max(capacity, 16);
+    h->harr = (node*)malloc(h->capacity * sizeof(node));
+    if(!h->harr || posix_memalign(&keys, 64, (h->capacity + HEAP_PAD) * sizeof(unsigned long long)) != 0) { // Cache line aligned
+        free(h->harr);
+        free(h);
+        return NULL;
+    }
+    h->keys = (unsigned long long*)keys;
+    h->wheel = (type == WHEEL_QUEUE) ? initializeWheel() : NULL;
+
+    return h;
+}
+
+// Doubles the capacity of the heap
+// There is no way to back out of an insert partway through a run, so running out of memory ends the program
+void growHeap(heap* h) {
+    void* keys;
+    node* harr = (node*)realloc(h->harr, 2 * h->capacity * sizeof(node));
+    if(!harr || posix_memalign(&keys, 64, (2 * h->capacity + HEAP_PAD) * sizeof(unsigned long long)) != 0) { // realloc can't keep the alignment
+        fprintf(stderr, "Out of memory growing a heap to %d nodes.\n", 2 * h->capacity);
+        exit(1);
+    }
+    h->harr = harr;
+    h->capacity *= 2;
+    memcpy(keys, h->keys, (h->curr_size + HEAP_PAD) * sizeof(unsigned long long));
+    free(h->keys);
+    h->keys = (unsigned long long*)keys;
+}
+
+// Gives the queued keys whose seq matches match under mask new seqs 0, 1, 2, ... in their current order, keeping the match bits
+// Used when an insertion counter is about to wrap. The order of every pair of keys is unchanged, so the heap and wheel slots stay valid
+// Returns the next free seq
+unsigned int renumberSeqs(heap* h, unsigned int mask, unsigned int match) {
+    int amt = h->curr_size + ((h->wheel != NULL) ? h->wheel->curr_size : 0);
+    unsigned long long** refs = (unsigned long long**)malloc((amt + 1) * sizeof(unsigned long long*));
+    if(!refs) {
+        fprintf(stderr, "Out of memory renumbering a heap.\n");
+        exit(1);
+    }
+    int found = 0;
+    for(int i = 0; i < h->curr_size; i++) {
+        if(((unsigned int)h->keys[i + HEAP_PAD] & mask) == match)
+            refs[found++] = &(h->keys[i + HEAP_PAD]);
+    }
+    for(int slot = 0; h->wheel != NULL && slot < WHEEL_SIZE; slot++) {
+        for(int e = h->wheel->head[slot]; e != -1; e = h->wheel->pool[e].next) {
+            if(((unsigned int)h->wheel->pool[e].key & mask) == match)
+                refs[found++] = &(h->wheel->pool[e].key);
+        }
+    }
+    qsort(refs, found, sizeof(unsigned long long*), compareKeyRefs);
+    for(int i = 0; i < found; i++) {
+        *(refs[i]) = (*(refs[i]) & 0xFFFFFFFF00000000ULL) | match | (unsigned int)i;
     }
+    free(refs);
+    return (unsigned int)found;
+}
+
+// Orders pointers to packed sort keys by the keys they point at
+int compareKeyRefs(const void* a, const void* b) {
+    unsigned long long ka = **(unsigned long long* const*)a;
+    unsigned long long kb = **(unsigned long long* const*)b;
+    return (ka > kb) - (ka < kb);
+}
 
-    // Bound checking
-    if(leftIndex < 0 || leftIndex >= h->curr_size) { leftIndex = -1;}
-    if(rightIndex < 0 || rightIndex >= h->curr_size) { rightIndex = -1;}
+// Ingests a list of processes into a new DES Min Heap
+heap* heapFromProcesses(process* pList, int pNum, queueType type) {
+    // Create a new heap, sized for one arrival per thread
+    int threadAmt = 0;
+    for(int i = 0; i < pNum; i++) {
+        threadAmt += pList[i].threadAmt;
+    }
+    heap* h = initializeHeap(threadAmt, type);
+    if(!h) { return NULL; }
+    unsigned int arrivalNo = 0;
 
-    min = i; // Set min to parent
-    if(leftIndex != -1) {
-        if(h->harr[leftIndex]->key < h->harr[min]->key) { // Compare left with min
-            min = leftIndex;
+    // Ingest data from array into heap
+    for(int i = 0; i < pNum; i++) {
+        for(int j = 0; j < pList[i].threadAmt; j++) {
+            insertArrival(h, &(pList[i].threads[j]), arrivalNo++);
         }
     }
-    if(rightIndex != -1) {
-        if(h->harr[rightIndex]->key < h->harr[min]->key) { // Compare right with min
-        min = rightIndex;
+
+    return h;
+}
+
+// Inserts a node with key, data, curr burst, and event, into the heap
+// Events with equal keys are removed in the order they were inserted, after any arrivals with that key
+void insertItem(heap* h, int key, void* data, int currBurst) {
+    node newNode;
+    newNode.currBurst = currBurst;
+    newNode.key = key;
+    newNode.data = data;
+    if(h->nextSeq >= EVENT_SEQ_BIT) // Every 31 bit seq has been handed out
+        h->nextSeq = renumberSeqs(h, EVENT_SEQ_BIT, EVENT_SEQ_BIT);
+    unsigned int seq = EVENT_SEQ_BIT | h->nextSeq++;
+    insertOrdered(h, ((unsigned long long)((unsigned int)key ^ EVENT_SEQ_BIT) << 32) | seq, newNode); // Flipping the sign bit sorts negative times first
+}
+
+// Inserts a thread's arrival into the heap
+// Arrivals at the same time are removed in arrivalNo order, so the order doesn't depend on when they were read
+void insertArrival(heap* h, thread* t, unsigned int arrivalNo) {
+    node newNode;
+    newNode.currBurst = 0;
+    newNode.key = t->arrTime;
+    newNode.data = t;
+    insertOrdered(h, ((unsigned long long)((unsigned int)t->arrTime ^ EVENT_SEQ_BIT) << 32) | (arrivalNo & ~EVENT_SEQ_BIT), newNode);
+}
+
+// Adds a node with a packed sort key to the wheel if it is close enough, otherwise to the heap
+void insertOrdered(heap* h, unsigned long long order, node n) {
+    STAT_INC(inserts);
+    if(h->wheel != NULL && n.key >= h->wheel->base && n.key - h->wheel->base < WHEEL_SIZE) { // Close enough for the wheel
+        insertWheel(h->wheel, order, n);
+    }
+    else {
+        insertHeap(h, order, n);
+    }
+    STAT_MAX(maxEventQueue, h->curr_size + (h->wheel != NULL ? h->wheel->curr_size : 0));
+    STAT_MAX(maxEventHeap, h->curr_size);
+}
+
+// Removes the minimum node from the heap or wheel
+// Returned by value, the heap's storage is not shrunk
+node removeMin(heap* h) {
+    node topNode = {0};
+    if(isEmpty(h)) {
+        return topNode;
+    }
+    STAT_INC(removes);
+
+    if(h->wheel == NULL) {
+        return removeHeapMin(h);
+    }
+
+    if(h->wheel->curr_size > 0 && (h->curr_size == 0 || wheelMinOrder(h->wheel) < h->keys[HEAP_PAD])) {
+        topNode = removeWheelMin(h->wheel);
+    }
+    else {
+        topNode = removeHeapMin(h);
+    }
+    advanceWheel(h, topNode.key);
+
+    return topNode;
+}
+
+// Adds a node with a packed sort key to the heap array
+void insertHeap(heap* h, unsigned long long order, node n) {
+    if(h->curr_size == h->capacity) { // Out of space, double the array
+        growHeap(h);
+    }
+
+    // Add node to the end of the heap
+    (h->harr)[h->curr_size] = n;
+    h->keys[h->curr_size + HEAP_PAD] = order;
+    h->curr_size++;
+
+    upheap(h, h->curr_size-1); // Restore heap balance
+}
+
+// Removes the minimum node from the heap array
+node removeHeapMin(heap* h) {
+    node topNode = {0};
+    if(h->curr_size > 0) {
+        topNode = (h->harr)[0];
+        h->curr_size--;
+        if(h->curr_size > 0) { // Move last node to the root
+            (h->harr)[0] = (h->harr)[h->curr_size];
+            h->keys[HEAP_PAD] = h->keys[h->curr_size + HEAP_PAD];
+            downheap(h, 0); // Rebalance heap
         }
     }
-    if(min != i) { // Swap the minimum with i
-        swapNodes( &((h->harr)[min]), &((h->harr)[i]) );
-        downheap(h, min);
+
+    return topNode;
+}
+
+// Rebalances heap after inserting
+// Moves parents down into the hole and writes node i once at its final position
+void upheap(heap* h, int i) {
+    unsigned long long* keys = h->keys + HEAP_PAD;
+    unsigned long long k = keys[i];
+    node n = (h->harr)[i];
+    int parentIndex;
+
+    while(i > 0) {
+        parentIndex = getParentIndex(i);
+        if(keys[parentIndex] < k) { // Parent is already smaller
+            break;
+        }
+        keys[i] = keys[parentIndex];
+        (h->harr)[i] = (h->harr)[parentIndex];
+        i = parentIndex;
+        STAT_INC(upheapSteps);
     }
+    keys[i] = k;
+    (h->harr)[i] = n;
 }
 
-// Swap two nodes
-void swapNodes(node** n1, node** n2) {
-    node* temp;
-    temp = *n1;
-    *n1 = *n2;
-    *n2 = temp;
+// Rebalances heap after removing
+// Moves the smallest child up into the hole and writes node i once at its final position
+void downheap(heap* h, int i) {
+    unsigned long long* keys = h->keys + HEAP_PAD;
+    unsigned long long k = keys[i];
+    node n = (h->harr)[i];
+    int childIndex;
+    int lastChild;
+    int minIndex;
+
+    while((childIndex = getChildIndex(i)) < h->curr_size) {
+        lastChild = min(childIndex + HEAP_ARITY, h->curr_size);
+        minIndex = childIndex;
+        for(int c = childIndex + 1; c < lastChild; c++) { // Siblings share a cache line
+            if(keys[c] < keys[minIndex]) {
+                minIndex = c;
+            }
+        }
+        if(k < keys[minIndex]) { // Node is smaller than all of its children
+            break;
+        }
+        keys[i] = keys[minIndex];
+        (h->harr)[i] = (h->harr)[minIndex];
+        i = minIndex;
+        STAT_INC(downheapSteps);
+    }
+    keys[i] = k;
+    (h->harr)[i] = n;
 }
 
 // Prints the current state of the heap
 // Used in debugging
 void printHeap(heap* h) {
     thread* t;
+    wheelEntry* e;
     if(h != NULL) {
         printf("---\n");
+        for(int i = 0; h->wheel != NULL && i < WHEEL_SIZE; i++) {
+            for(int j = h->wheel->head[(h->wheel->base + i) & (WHEEL_SIZE - 1)]; j != -1; j = e->next) {
+                e = &(h->wheel->pool[j]);
+                t = (thread*)e->n.data;
+                printf("Key: %d, Thread #: %d, Process #: %d, currentBurst: %d (wheel)\n", 
+                e->n.key, t->TNo, t->PNo, e->n.currBurst);
+            }
+        }
         for(int i = 0; i < h->curr_size; i++) {
-            t = (thread*)(h->harr)[i]->data;
-            printf("Key: %d, Thread #: %d, Process #: %d, currentBurst: %d, event: %s\n", 
-            (h->harr)[i]->key, t->TNo, t->PNo, (h->harr)[i]->currBurst);
+            t = (thread*)(h->harr)[i].data;
+            printf("Key: %d, Thread #: %d, Process #: %d, currentBurst: %d\n", 
+            (h->harr)[i].key, t->TNo, t->PNo, (h->harr)[i].currBurst);
         }
         printf("---\n");
     }
@@ -577,102 +2011,1842 @@ void printHeap(heap* h) {
 // Does not free the node's contents
 void freeHeap(heap* h) {
     if(h != NULL) {
-        for(int i = 0; i < h->curr_size; i++) {
-            free((h->harr)[i]);
-        }
         if(h->harr != NULL)
             free(h->harr);
+        if(h->keys != NULL)
+            free(h->keys);
+        freeWheel(h->wheel);
         free(h);
     }
 }
 
 // Peaks at the heap and returns the minimum key
 int minKey(heap* h) {
-    if(h != NULL && h->curr_size != 0) {
-        return ( (h->harr)[0]->key);
+    node* n = minElement(h);
+    if(n != NULL) {
+        return n->key;
     }
     return -1;
 }
 
 // Peaks at the heap and returns the minimum key's node
 node* minElement(heap* h) {
+    if(h != NULL && h->wheel != NULL && h->wheel->curr_size != 0) {
+        if(h->curr_size == 0 || wheelMinOrder(h->wheel) < h->keys[HEAP_PAD]) {
+            return &(h->wheel->pool[h->wheel->head[findWheelMin(h->wheel)]].n);
+        }
+    }
     if(h != NULL && h->curr_size != 0) {
-        return (h->harr)[0];
+        return &((h->harr)[0]);
     }
     return NULL;
 }
 
-int getParentIndex(int index) {
-    return (index - 1) / 2;
-}
+/* TIMING WHEEL FUNCTIONS */
 
-int getLeftIndex(int index) {
-    return 2*index + 1;
+// Allocates an empty timing wheel covering [0, WHEEL_SIZE)
+// Must be freed by caller
+timingWheel* initializeWheel() {
+    timingWheel* w = (timingWheel*)malloc(sizeof(timingWheel));
+    for(int i = 0; i < WHEEL_SIZE; i++) {
+        w->head[i] = -1;
+        w->tail[i] = -1;
+    }
+    memset(w->occupied, 0, sizeof(w->occupied));
+    w->poolCapacity = 0;
+    w->pool = NULL;
+    w->freeList = -1;
+    w->base = 0;
+    w->minSlot = -1;
+    w->curr_size = 0;
+
+    return w;
 }
 
-int getRightIndex(int index) {
-    return 2*index + 2;
+// Adds a node to its time slot, keeping the slot sorted by order
+// Orders only increase outside of streamed arrivals, so this is nearly always an append
+// The caller must make sure n.key is in [base, base + WHEEL_SIZE)
+void insertWheel(timingWheel* w, unsigned long long order, node n) {
+    if(w->freeList == -1) { // Out of entries, double the pool and chain the new ones on the free list
+        int oldCapacity = w->poolCapacity;
+        w->poolCapacity = max(2 * oldCapacity, 64);
+        w->pool = (wheelEntry*)realloc(w->pool, w->poolCapacity * sizeof(wheelEntry));
+        for(int i = w->poolCapacity - 1; i >= oldCapacity; i--) {
+            w->pool[i].next = w->freeList;
+            w->freeList = i;
+        }
+    }
+
+    int entry = w->freeList;
+    int slot = n.key & (WHEEL_SIZE - 1);
+    w->freeList = w->pool[entry].next;
+    w->pool[entry].key = order;
+    w->pool[entry].n = n;
+    w->pool[entry].next = -1;
+
+    if(w->head[slot] == -1) { // First event at this time
+        w->head[slot] = entry;
+        w->tail[slot] = entry;
+        w->occupied[slot / 64] |= 1ULL << (slot % 64);
+    }
+    else if(w->pool[w->tail[slot]].key < order) { // Usual case, sorts after everything already in the slot
+        w->pool[w->tail[slot]].next = entry;
+        w->tail[slot] = entry;
+    }
+    else if(w->pool[w->head[slot]].key > order) { // Streamed arrival that sorts before the whole slot
+        w->pool[entry].next = w->head[slot];
+        w->head[slot] = entry;
+    }
+    else { // Streamed arrival that sorts into the middle of the slot
+        int prev = w->head[slot];
+        while(w->pool[w->pool[prev].next].key < order) {
+            prev = w->pool[prev].next;
+        }
+        w->pool[entry].next = w->pool[prev].next;
+        w->pool[prev].next = entry;
+    }
+    w->curr_size++;
+
+    if(w->minSlot != -1 && ((n.key - w->base) < ((w->minSlot - w->base) & (WHEEL_SIZE - 1)))) { // New earliest event
+        w->minSlot = slot;
+    }
 }
 
-/* Other Functions */
+// Finds the first occupied slot at or after base, one 64 slot word at a time
+// Must only be called on a non-empty wheel
+int findWheelMin(timingWheel* w) {
+    if(w->minSlot != -1) {
+        return w->minSlot;
+    }
 
-int min( int n1, int n2 ) {
-    return (n1 <= n2) ? n1 : n2;
+    int slot = w->base & (WHEEL_SIZE - 1);
+    int word = slot / 64;
+    unsigned long long bits = w->occupied[word] & (~0ULL << (slot % 64)); // Ignore slots before base in the first word
+    while(bits == 0) {
+        word = (word + 1) % (WHEEL_SIZE / 64);
+        bits = w->occupied[word];
+    }
+    w->minSlot = word * 64 + __builtin_ctzll(bits);
+
+    return w->minSlot;
 }
 
-int max( int n1, int n2 ) {
-    return (n1 >= n2) ? n1 : n2;
+// Returns the packed sort key of the earliest event in the wheel
+unsigned long long wheelMinOrder(timingWheel* w) {
+    return w->pool[w->head[findWheelMin(w)]].key;
 }
 
-// Switches a threads state, and prints info if verbose is turned on
-void stateSwitch(thread* t, state s, int nextAvailTime) {
-    if(t != NULL) {
-        state prevState = t->s;
-        t->s = s;
-        if(verbose)
-            printf("At time %d: Thread %d of Process %d moves from %s to %s.\n", nextAvailTime, t->TNo, t->PNo, enumString[prevState], enumString[s]);
+// Removes and returns the earliest event in the wheel
+// Must only be called on a non-empty wheel
+node removeWheelMin(timingWheel* w) {
+    int slot = findWheelMin(w);
+    int entry = w->head[slot];
+    node topNode = w->pool[entry].n;
+
+    w->head[slot] = w->pool[entry].next;
+    if(w->head[slot] == -1) { // Slot is now empty
+        w->tail[slot] = -1;
+        w->occupied[slot / 64] &= ~(1ULL << (slot % 64));
+        w->minSlot = -1;
     }
+    w->pool[entry].next = w->freeList;
+    w->freeList = entry;
+    w->curr_size--;
+
+    return topNode;
 }
 
-// Increments all keys within a heap if it is not part of the ready queue
-void incrementAllKeys(heap* h, int amt) {
-    if(h != NULL) {
-        for(int i = 0; i < h->curr_size; i++) {
-            (h->harr)[i]->key += amt;
-        }
+// Moves the wheel up to the time of the last removed event
+// Heap events that now fall inside the wheel are moved into it in (time, seq) order
+void advanceWheel(heap* h, int time) {
+    timingWheel* w = h->wheel;
+    if(time <= w->base) {
+        return;
+    }
+
+    w->base = time;
+    w->minSlot = -1;
+    while(h->curr_size > 0 && (h->harr)[0].key >= w->base && (h->harr)[0].key - w->base < WHEEL_SIZE) {
+        unsigned long long order = h->keys[HEAP_PAD];
+        insertWheel(w, order, removeHeapMin(h));
     }
 }
 
-// Allocates space for a new heap representing the ready queue
-// Must be freed by caller
-heap* initializeReadyQueue() {
-    heap* h;
-    h = (heap*)malloc(sizeof(heap));
-    h->curr_size = 0;
+// Frees a timing wheel and its entry pool
+void freeWheel(timingWheel* w) {
+    if(w != NULL) {
+        if(w->pool != NULL)
+            free(w->pool);
+        free(w);
+    }
+}
 
-    return h;
+int getParentIndex(int index) {
+    return (index - 1) / HEAP_ARITY;
+}
+
+int getChildIndex(int index) {
+    return HEAP_ARITY*index + 1;
+}
+
+/* Other Functions */
+
+int min( int n1, int n2 ) {
+    return (n1 <= n2) ? n1 : n2;
+}
+
+int max( int n1, int n2 ) {
+    return (n1 >= n2) ? n1 : n2;
+}
+
+// Returns a monotonic time in seconds
+double getTime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Prints how long each phase took, how fast events were processed, and the peak memory use to stderr
+void printBenchmark(double* phaseTimes, long long eventAmt) {
+    char* names[BENCH_PHASES] = {"parse", "heap build", "event loop", "stats"};
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    fprintf(stderr, "Benchmark:\n");
+    for(int i = 0; i < BENCH_PHASES; i++) {
+        fprintf(stderr, "\t%-12s %10.3f ms\n", names[i], phaseTimes[i] * 1000);
+    }
+    fprintf(stderr, "\t%-12s %10lld\n", "events", eventAmt);
+    if(eventAmt > 0 && phaseTimes[BENCH_LOOP] > 0)
+        fprintf(stderr, "\t%-12s %10.0f events/s, %.1f ns/event\n", "throughput", eventAmt / phaseTimes[BENCH_LOOP], phaseTimes[BENCH_LOOP] * 1e9 / eventAmt);
+    fprintf(stderr, "\t%-12s %10ld KB\n", "peak RSS", usage.ru_maxrss);
+}
+
+#ifdef SIM_STATS
+// Writes the hot path counters and the time spent in each phase to path as a JSON object
+// Build settings are included so results from different builds can be told apart
+bool writeStats(char* path, double* phaseTimes, runContext* ctx) {
+    FILE* out = fopen(path, "w");
+    if(out == NULL) {
+        return false;
+    }
+    int depth = 0; // Levels of a HEAP_ARITY-ary heap holding maxEventHeap nodes
+    for(long long levelSize = 1, total = 0; total < stats.maxEventHeap; levelSize *= HEAP_ARITY) {
+        total += levelSize;
+        depth++;
+    }
+    fprintf(out, "{\n");
+    fprintf(out, "  \"build\": {\"heap_arity\": %d},\n", HEAP_ARITY);
+    fprintf(out, "  \"config\": {\"policy\": \"%s\", \"quantum\": %d, \"cores\": %d, \"event_queue\": \"%s\", \"fast_forward\": %s, \"io_channels\": %d, \"io_sched\": \"%s\"},\n",
+        ctx->sched->name, ctx->RRTime, ctx->coreAmt, (ctx->eventQueueType == WHEEL_QUEUE) ? "wheel" : "heap", ctx->fastForward ? "true" : "false",
+        ctx->ioChannels, (ctx->ioSchedule == IO_ELEVATOR) ? "elevator" : "fifo");
+    fprintf(out, "  \"events\": %lld,\n", ctx->eventAmt);
+    fprintf(out, "  \"event_queue\": {\"inserts\": %lld, \"removes\": %lld, \"max_size\": %d, \"max_heap_size\": %d, \"max_heap_depth\": %d},\n",
+        stats.inserts, stats.removes, stats.maxEventQueue, stats.maxEventHeap, depth);
+    fprintf(out, "  \"sift_steps\": {\"upheap\": %lld, \"downheap\": %lld},\n", stats.upheapSteps, stats.downheapSteps);
+    fprintf(out, "  \"max_ready_queue\": %d,\n", stats.maxReadyQueue);
+    fprintf(out, "  \"context_switches\": {\"thread\": %lld, \"process\": %lld},\n", stats.threadSwitches, stats.processSwitches);
+    fprintf(out, "  \"phase_seconds\": {\"parse\": %.9f, \"heap_build\": %.9f, \"simulation\": %.9f, \"reporting\": %.9f}\n",
+        phaseTimes[BENCH_PARSE], phaseTimes[BENCH_HEAP], phaseTimes[BENCH_LOOP], phaseTimes[BENCH_STATS]);
+    fprintf(out, "}\n");
+    return fclose(out) == 0;
+}
+#endif
+
+// Switches a threads state, and prints info if verbose is turned on
+SIM_INLINE void stateSwitch(runContext* ctx, thread* t, state s, int nextAvailTime, bool traced) {
+    if(t != NULL) {
+        state prevState = t->s;
+        t->s = s;
+        if(traced && ctx->textTrace != NULL)
+            traceTransition(ctx->textTrace, nextAvailTime, t, prevState, s);
+        if(traced && ctx->binaryTrace != NULL)
+            traceTransition(ctx->binaryTrace, nextAvailTime, t, prevState, s);
+    }
+}
+
+// Allocates space for a new ring buffer representing the ready queue
+// Must be freed by caller
+readyQueue* initializeReadyQueue() {
+    readyQueue* rq;
+    rq = (readyQueue*)malloc(sizeof(readyQueue));
+    rq->head = 0;
+    rq->curr_size = 0;
+    rq->capacity = 16;
+    rq->buf = (node*)malloc(rq->capacity * sizeof(node));
+
+    return rq;
+}
+
+// Checks if the ready queue is empty
+bool isReadyQueueEmpty(readyQueue* rq) {
+    if(rq == NULL) {
+        return true;
+    }
+    return rq->curr_size == 0;
+}
+
+// Doubles the ring buffer, unwrapping it so the front of the queue is at index 0
+void growReadyQueue(readyQueue* rq) {
+    node* newBuf = (node*)malloc(2 * rq->capacity * sizeof(node));
+    for(int i = 0; i < rq->curr_size; i++) {
+        newBuf[i] = rq->buf[(rq->head + i) & (rq->capacity - 1)];
+    }
+    free(rq->buf);
+    rq->buf = newBuf;
+    rq->head = 0;
+    rq->capacity *= 2;
 }
 
 // Add new node to end of ready queue
 // data: a thread pointer
 // currBurst: the current burst of the thread (usually taken from another node)
-void pushReadyQueue(heap* rq, void* data, int currBurst) {
-    insertItem(rq, rq->curr_size, data, currBurst);
+void pushReadyQueue(readyQueue* rq, void* data, int currBurst) {
+    if(rq->curr_size == rq->capacity) {
+        growReadyQueue(rq);
+    }
+    node* slot = &(rq->buf[(rq->head + rq->curr_size) & (rq->capacity - 1)]);
+    slot->key = 0;
+    slot->data = data;
+    slot->currBurst = currBurst;
+    rq->curr_size++;
 }
 
-// Remove and return the 0th element of the ready queue
-node* popReadyQueue(heap* rq) {
-    node* retNode = removeMin(rq);
-    incrementAllKeys(rq, -1); // Shift left by one so min key is always 0
+// Remove and return the front element of the ready queue
+// Returned by value since the slot can be reused by the next push
+node popReadyQueue(readyQueue* rq) {
+    node retNode = rq->buf[rq->head];
+    if(rq->curr_size > READY_PREFETCH) { // Start loading the threads that will be dispatched soon, their live burst state is inside them
+        node* ahead = &(rq->buf[(rq->head + READY_PREFETCH) & (rq->capacity - 1)]);
+        __builtin_prefetch(ahead->data);
+    }
+    rq->head = (rq->head + 1) & (rq->capacity - 1);
+    rq->curr_size--;
     return retNode;
 }
 
-// Remove the next event from the heap and add it to the ready queue
-void parseNextEvent(heap* h, heap* rq) {
+// Frees the ready queue
+// Does not free the node's contents
+void freeReadyQueue(readyQueue* rq) {
+    if(rq != NULL) {
+        free(rq->buf);
+        free(rq);
+    }
+}
+
+// Remove the next event from the heap and add it to a core's ready queue
+// Returns the core it was added to, -1 if the heap was empty
+SIM_INLINE int parseNextEvent(runContext* ctx, heap* h, core* cores, loopKind kind, bool traced) {
+    int target = -1;
     if(!isEmpty(h)) {
-        node* n = removeMin(h);
-        thread* t = (thread*)(n->data);
-        stateSwitch(t, READY, n->key); // Set this thread to ready
-        pushReadyQueue(rq, t, n->currBurst); // Add the start time back into the event queue
+        node n = removeMin(h);
+        thread* t = (thread*)(n.data);
+        if(t->s == NEW)
+            recordArrival(&(ctx->metrics), t);
+        else if(ctx->device != NULL) // I/O finished, its channel goes to the next request
+            finishIo(ctx->device, h, n.key);
+        stateSwitch(ctx, t, READY, n.key, traced); // Set this thread to ready
+        target = pickCore(ctx, cores, t, kind);
+        pushReady(ctx, cores[target].rq, t, n.currBurst, kind); // Add the start time back into the event queue
+        STAT_MAX(maxReadyQueue, readySize(ctx, cores[target].rq, kind));
+    }
+    return target;
+}
+
+/* METRICS FUNCTIONS */
+
+// Starts a run's statistics with no process arrived yet
+void initializeMetrics(runMetrics* m, int processAmt) {
+    m->processAmt = processAmt;
+    m->processEnd = (int*)malloc((processAmt + 1) * sizeof(int));
+    for(int i = 0; i < processAmt; i++) {
+        m->processEnd[i] = -1;
+    }
+    m->processTurnaround = 0;
+    m->waitingTime = 0;
+    m->responseTime = 0;
+    m->threadsStarted = 0;
+    m->threadsDone = 0;
+    memset(&(m->turnaround), 0, sizeof(quantileSketch));
+}
+
+// Marks the start of t's process if t is its first thread to arrive
+void recordArrival(runMetrics* m, thread* t) {
+    if(m->processEnd[t->processIndex] == -1)
+        m->processEnd[t->processIndex] = t->arrTime;
+}
+
+// Adds the time t waited before it first got a CPU
+void recordFirstRun(runMetrics* m, thread* t, int time) {
+    m->responseTime += time - t->arrTime;
+    m->threadsStarted++;
+}
+
+// Folds a terminated thread into the running sums
+// A process' turnaround grows by however much t finished after the latest of its other threads
+void recordTermination(runMetrics* m, thread* t) {
+    int turnaround = t->finTime - t->arrTime;
+    int* processEnd = &(m->processEnd[t->processIndex]);
+    m->waitingTime += turnaround - t->serviceTime - t->ioTime;
+    m->threadsDone++;
+    addSketch(&(m->turnaround), turnaround);
+    if(t->finTime > *processEnd) {
+        m->processTurnaround += t->finTime - *processEnd;
+        *processEnd = t->finTime;
+    }
+}
+
+// Turns the running sums into the averages and percentiles reported for the run
+void finishMetrics(runContext* ctx) {
+    runMetrics* m = &(ctx->metrics);
+    ctx->avgTurnaround = (m->processAmt > 0) ? (double)m->processTurnaround / m->processAmt : 0;
+    ctx->avgWaiting = (m->threadsDone > 0) ? (double)m->waitingTime / m->threadsDone : 0;
+    ctx->avgResponse = (m->threadsStarted > 0) ? (double)m->responseTime / m->threadsStarted : 0;
+    ctx->turnaroundPercentiles[0] = sketchQuantile(&(m->turnaround), 0.50);
+    ctx->turnaroundPercentiles[1] = sketchQuantile(&(m->turnaround), 0.95);
+    ctx->turnaroundPercentiles[2] = sketchQuantile(&(m->turnaround), 0.99);
+    free(m->processEnd);
+    m->processEnd = NULL;
+}
+
+// Adds from's sums and sketch into into
+// Only valid when the two runs covered different processes, a process' turnaround can't be split across runs
+void mergeMetrics(runMetrics* into, runMetrics* from) {
+    into->processTurnaround += from->processTurnaround;
+    into->waitingTime += from->waitingTime;
+    into->responseTime += from->responseTime;
+    into->threadsStarted += from->threadsStarted;
+    into->threadsDone += from->threadsDone;
+    for(int i = 0; i < SKETCH_BUCKETS; i++) {
+        into->turnaround.counts[i] += from->turnaround.counts[i];
+    }
+    into->turnaround.total += from->turnaround.total;
+}
+
+// Counts val in the bucket covering it
+// Values from 2^e up to 2^(e+1) share 2^SKETCH_SUB_BITS buckets, so each bucket is at most 1/2^SKETCH_SUB_BITS of its values wide
+void addSketch(quantileSketch* q, int val) {
+    unsigned int v = (unsigned int)max(val, 0);
+    int bucket = (int)v;
+    if(v >= (1U << SKETCH_SUB_BITS)) {
+        int shift = (31 - __builtin_clz(v)) - SKETCH_SUB_BITS; // Low bits dropped so SKETCH_SUB_BITS + 1 remain
+        bucket = ((shift + 1) << SKETCH_SUB_BITS) + (int)((v >> shift) & ((1U << SKETCH_SUB_BITS) - 1));
+    }
+    q->counts[bucket]++;
+    q->total++;
+}
+
+// Walks the buckets until fraction of the values have been passed, returns the middle of that bucket
+int sketchQuantile(quantileSketch* q, double fraction) {
+    if(q->total == 0) {
+        return 0;
+    }
+    long long rank = (long long)(fraction * q->total); // Nearest rank, 1 based
+    if(rank < fraction * q->total || rank == 0)
+        rank++;
+    long long seen = 0;
+    int bucket = 0;
+    while(bucket < SKETCH_BUCKETS - 1 && (seen += q->counts[bucket]) < rank) {
+        bucket++;
+    }
+    if(bucket < (1 << SKETCH_SUB_BITS)) { // Exact
+        return bucket;
+    }
+    int shift = (bucket >> SKETCH_SUB_BITS) - 1;
+    long long low = (long long)((1 << SKETCH_SUB_BITS) + (bucket & ((1 << SKETCH_SUB_BITS) - 1))) << shift;
+    return (int)(low + ((1LL << shift) - 1) / 2);
+}
+
+/* REPLAY FUNCTIONS */
+
+// Rebuilds a workload from a perf sched script or ftrace log of sched_switch and sched_wakeup events
+// A thread runs while the log has it switched in, and blocks from being switched out while not runnable until its next wakeup
+// Each command name is replayed as one process, and every unit nanoseconds of the log is one time unit
+// The log is read one line at a time, only the threads still alive are kept apart from the finished workload
+bool loadReplay(inputReader* in, arena* a, process** p, int* processAmt, long long unit) {
+    replayLog r = { .a = a, .unit = unit };
+    char line[REPLAY_LINE_LEN];
+    schedEvent ev;
+    size_t released = 0; // Bytes of a mapped log handed back to the kernel
+    while(readRawLine(in, line, REPLAY_LINE_LEN)) {
+        if(parseSchedLine(line, &ev))
+            replayEvent(&r, &ev);
+        if(in->mapped && in->pos - released >= REPLAY_RELEASE_SIZE) { // Lines already read are never looked at again, so a mapped log doesn't stay resident
+            size_t upTo = in->pos & ~((size_t)sysconf(_SC_PAGESIZE) - 1);
+            madvise(in->buf + released, upTo - released, MADV_DONTNEED);
+            released = upTo;
+        }
+    }
+    for(int pid = 0; pid < r.pidCap; pid++) { // Threads still alive at the end of the log end there
+        if(r.byPid[pid] != NULL)
+            finishReplayThread(&r, pid);
+    }
+
+    bool valid = false;
+    if(r.doneAmt == 0)
+        fprintf(stderr, "No sched_switch or sched_wakeup events in the scheduler log.\n");
+    else if(r.now > INT_MAX)
+        fprintf(stderr, "The scheduler log spans %lld time units, more than the simulation can count. Use a larger --replay-unit.\n", r.now);
+    else
+        valid = true;
+    if(valid) {
+        buildReplayProcesses(&r, p, processAmt);
+    }
+    free(r.byPid);
+    free(r.groups);
+    free(r.groupTable);
+    free(r.done);
+    return valid;
+}
+
+// Splits a log line into the event it records
+// Works for perf sched script and ftrace lines, the timestamp is the first seconds.fraction: word and the event name follows it
+bool parseSchedLine(char* line, schedEvent* ev) {
+    char* word = line;
+    char* end;
+    char* c;
+    bool stamp = false;
+    while(!stamp && *word != '\0') {
+        while(*word == ' ' || *word == '\t') { word++; }
+        for(end = word; *end != '\0' && *end != ' ' && *end != '\t'; end++);
+        for(c = word; *c >= '0' && *c <= '9'; c++);
+        if(c > word && *c == '.') {
+            for(c++; *c >= '0' && *c <= '9'; c++);
+            stamp = (*c == ':' && c + 1 == end && c[-1] != '.');
+        }
+        if(!stamp)
+            word = end;
+    }
+    if(!stamp) {
+        return false;
+    }
+
+    long long seconds = 0;
+    long long fraction = 0;
+    int digits = 0;
+    for(c = word; *c != '.'; c++) {
+        seconds = seconds * 10 + (*c - '0');
+    }
+    for(c++; *c != ':'; c++) {
+        if(digits < 9) { // Anything past nanoseconds is dropped
+            fraction = fraction * 10 + (*c - '0');
+            digits++;
+        }
+    }
+    for(; digits < 9; digits++) {
+        fraction *= 10;
+    }
+    ev->time = seconds * 1000000000LL + fraction;
+
+    // Event name, perf prefixes it with its subsystem
+    for(word = end; *word == ' ' || *word == '\t'; word++);
+    for(end = word; *end != '\0' && *end != ' ' && *end != '\t'; end++);
+    if(strncmp(word, "sched:", 6) == 0)
+        word += 6;
+    size_t nameLen = (end > word && end[-1] == ':') ? (size_t)(end - word - 1) : (size_t)(end - word);
+    if(nameLen == 12 && strncmp(word, "sched_switch", 12) == 0)
+        ev->type = LOG_SWITCH;
+    else if((nameLen == 12 && strncmp(word, "sched_wakeup", 12) == 0) || (nameLen == 16 && strncmp(word, "sched_wakeup_new", 16) == 0))
+        ev->type = LOG_WAKEUP;
+    else if(nameLen == 18 && strncmp(word, "sched_process_exit", 18) == 0)
+        ev->type = LOG_EXIT;
+    else {
+        ev->type = LOG_OTHER;
+        return false;
+    }
+
+    char* payload = end;
+    if(ev->type != LOG_SWITCH) {
+        return parseSchedTask(payload, "comm=", " pid=", ev->comm, &(ev->pid));
+    }
+    char* arrow = strstr(payload, "==>");
+    if(arrow == NULL) {
+        return false;
+    }
+    *arrow = '\0';
+    if(!parseSchedTask(payload, "prev_comm=", " prev_pid=", ev->comm, &(ev->pid)) || !parseSchedTask(arrow + 3, "next_comm=", " next_pid=", ev->nextComm, &(ev->nextPid))) {
+        return false;
+    }
+    char* prevState = strstr(payload, "prev_state=");
+    if(prevState != NULL) {
+        prevState += 11;
+    }
+    else { // Short form, comm:pid [prio] state
+        prevState = strrchr(payload, ']');
+        if(prevState == NULL) {
+            return false;
+        }
+        for(prevState++; *prevState == ' '; prevState++);
+    }
+    ev->prevState = *prevState;
+    return *prevState != '\0';
+}
+
+// Reads a task's name and pid from text, either commKey=name pidKey=pid or perf's short name:pid [prio]
+// Names may hold spaces, so a long form name runs up to pidKey and a short form one up to the last colon before its priority
+bool parseSchedTask(char* text, char* commKey, char* pidKey, char* comm, int* pid) {
+    char* start = strstr(text, commKey);
+    char* stop;
+    char* pidStart;
+    if(start != NULL) {
+        start += strlen(commKey);
+        stop = strstr(start, pidKey);
+        if(stop == NULL) {
+            return false;
+        }
+        pidStart = stop + strlen(pidKey);
+    }
+    else {
+        char* bracket = strstr(text, " [");
+        if(bracket == NULL) {
+            return false;
+        }
+        for(start = text; *start == ' '; start++);
+        for(stop = bracket; stop > start && *stop != ':'; stop--);
+        if(*stop != ':') {
+            return false;
+        }
+        pidStart = stop + 1;
+    }
+    if(*pidStart < '0' || *pidStart > '9') {
+        return false;
+    }
+    size_t len = min((int)(stop - start), REPLAY_COMM_LEN - 1);
+    memcpy(comm, start, len);
+    comm[len] = '\0';
+    *pid = atoi(pidStart);
+    return true;
+}
+
+// Moves the threads an event touches through running, ready and blocked
+void replayEvent(replayLog* r, schedEvent* ev) {
+    if(!r->started) {
+        r->base = ev->time;
+        r->started = true;
+    }
+    long long time = (ev->time - r->base) / r->unit;
+    if(time < r->now) // Logs merged from several CPUs can be slightly out of order
+        time = r->now;
+    r->now = time;
+
+    replayThread* rt;
+    if(ev->type == LOG_SWITCH) {
+        if(ev->pid != 0) { // The idle task isn't replayed
+            rt = (ev->pid < r->pidCap) ? r->byPid[ev->pid] : NULL;
+            if(rt != NULL && rt->s == RUNNING) {
+                rt->cpu += time - rt->since;
+                rt->s = READY;
+            }
+            if(ev->prevState == 'X' || ev->prevState == 'Z') { // Exited
+                if(rt != NULL)
+                    finishReplayThread(r, ev->pid);
+            }
+            else if(ev->prevState == 'R') { // Preempted, still runnable
+                replayThreadFor(r, ev->pid, ev->comm, READY);
+            }
+            else if(rt != NULL) {
+                rt->s = BLOCKED;
+                rt->since = time;
+            }
+        }
+        if(ev->nextPid != 0) {
+            rt = replayThreadFor(r, ev->nextPid, ev->nextComm, READY);
+            if(rt->s == BLOCKED) // Its wakeup is missing from the log
+                endReplayBurst(rt, time - rt->since);
+            rt->s = RUNNING;
+            rt->since = time;
+        }
+    }
+    else if(ev->type == LOG_WAKEUP && ev->pid != 0) {
+        rt = replayThreadFor(r, ev->pid, ev->comm, READY);
+        if(rt->s == BLOCKED) {
+            endReplayBurst(rt, time - rt->since);
+            rt->s = READY;
+        }
+    }
+    else if(ev->type == LOG_EXIT && ev->pid < r->pidCap && r->byPid[ev->pid] != NULL) {
+        finishReplayThread(r, ev->pid);
+    }
+}
+
+// Returns the live thread with pid, a thread seen for the first time arrives now in state s
+replayThread* replayThreadFor(replayLog* r, int pid, char* comm, state s) {
+    if(pid >= r->pidCap) {
+        int cap = max(pid + 1, r->pidCap * 2);
+        r->byPid = (replayThread**)realloc(r->byPid, cap * sizeof(replayThread*));
+        memset(r->byPid + r->pidCap, 0, (cap - r->pidCap) * sizeof(replayThread*));
+        r->pidCap = cap;
+    }
+    if(r->byPid[pid] == NULL) {
+        replayThread* rt = (replayThread*)calloc(1, sizeof(replayThread));
+        rt->s = s;
+        rt->since = r->now;
+        rt->arrTime = r->now;
+        rt->group = replayGroupFor(r, comm);
+        rt->seq = r->threadsSeen++;
+        r->byPid[pid] = rt;
+    }
+    return r->byPid[pid];
+}
+
+// Ends the burst in progress, followed by ioTime of I/O
+// Bursts get at least one unit of CPU time since a burst with none would be taken for its I/O
+void endReplayBurst(replayThread* rt, long long ioTime) {
+    if(rt->burstAmt == rt->burstCap) {
+        rt->burstCap = max(4, rt->burstCap * 2);
+        rt->bursts = (cpuBurst*)realloc(rt->bursts, rt->burstCap * sizeof(cpuBurst));
+    }
+    cpuBurst* b = &(rt->bursts[rt->burstAmt++]);
+    b->cpuTime = (rt->cpu > 0) ? (int)rt->cpu : 1;
+    b->ioTime = (int)ioTime;
+    rt->cpu = 0;
+}
+
+// Adds the thread with pid to the finished threads, with its burst in progress as its last
+// A thread blocked at the end of the log ends with the burst before its I/O
+void finishReplayThread(replayLog* r, int pid) {
+    replayThread* rt = r->byPid[pid];
+    if(rt->s == RUNNING)
+        rt->cpu += r->now - rt->since;
+    endReplayBurst(rt, 0);
+    cpuBurst* bursts = (cpuBurst*)arenaAlloc(r->a, rt->burstAmt * sizeof(cpuBurst));
+    memcpy(bursts, rt->bursts, rt->burstAmt * sizeof(cpuBurst));
+
+    if(r->doneAmt == r->doneCap) {
+        r->doneCap = max(64, r->doneCap * 2);
+        r->done = (thread*)realloc(r->done, r->doneCap * sizeof(thread));
+    }
+    thread* t = &(r->done[r->doneAmt++]);
+    initializeThread(t);
+    t->arrTime = (int)rt->arrTime;
+    t->burstNo = rt->burstAmt;
+    t->bursts = bursts;
+    t->processIndex = rt->group;
+    t->TNo = rt->seq; // Renumbered within the process by buildReplayProcesses
+    sumBurstTimes(t);
+    resetThread(t);
+
+    free(rt->bursts);
+    free(rt);
+    r->byPid[pid] = NULL;
+}
+
+// Returns the process threads named comm are replayed as, adding one the first time a name is seen
+int replayGroupFor(replayLog* r, char* comm) {
+    if(r->groupAmt * 2 >= r->groupTableCap) { // Rehash into a table twice as large, keeping it at most half full
+        int cap = max(64, r->groupTableCap * 2);
+        int* table = (int*)malloc(cap * sizeof(int));
+        memset(table, -1, cap * sizeof(int));
+        for(int g = 0; g < r->groupAmt; g++) {
+            unsigned int slot = hashComm(r->groups[g]) & (cap - 1);
+            while(table[slot] != -1) { slot = (slot + 1) & (cap - 1); }
+            table[slot] = g;
+        }
+        free(r->groupTable);
+        r->groupTable = table;
+        r->groupTableCap = cap;
+    }
+
+    unsigned int slot = hashComm(comm) & (r->groupTableCap - 1);
+    while(r->groupTable[slot] != -1) {
+        if(strcmp(r->groups[r->groupTable[slot]], comm) == 0)
+            return r->groupTable[slot];
+        slot = (slot + 1) & (r->groupTableCap - 1);
+    }
+    if(r->groupAmt == r->groupCap) {
+        r->groupCap = max(64, r->groupCap * 2);
+        r->groups = (char (*)[REPLAY_COMM_LEN])realloc(r->groups, r->groupCap * REPLAY_COMM_LEN);
+    }
+    strcpy(r->groups[r->groupAmt], comm);
+    r->groupTable[slot] = r->groupAmt;
+    return r->groupAmt++;
+}
+
+// FNV-1a of a command name
+unsigned int hashComm(char* comm) {
+    unsigned int hash = 2166136261U;
+    for(; *comm != '\0'; comm++) {
+        hash = (hash ^ (unsigned char)*comm) * 16777619U;
+    }
+    return hash;
+}
+
+// Lays the finished threads out by process, each process' threads in order of arrival
+// Processes are numbered in the order their command names were first seen
+void buildReplayProcesses(replayLog* r, process** p, int* processAmt) {
+    qsort(r->done, r->doneAmt, sizeof(thread), compareReplayThreads);
+    thread* threads = (thread*)arenaAlloc(r->a, r->doneAmt * sizeof(thread));
+    memcpy(threads, r->done, r->doneAmt * sizeof(thread));
+
+    *processAmt = r->groupAmt;
+    *p = (process*)arenaAlloc(r->a, r->groupAmt * sizeof(process));
+    for(int g = 0; g < r->groupAmt; g++) {
+        (*p)[g].threads = NULL;
+        (*p)[g].threadAmt = 0;
+    }
+    for(int i = 0; i < r->doneAmt; i++) {
+        thread* t = &(threads[i]);
+        process* proc = &((*p)[t->processIndex]);
+        if(proc->threads == NULL)
+            proc->threads = t;
+        t->TNo = ++(proc->threadAmt);
+        t->PNo = t->processIndex + 1;
+    }
+}
+
+// Orders threads by process, then arrival, then the order they were first seen
+int compareReplayThreads(const void* a, const void* b) {
+    const thread* x = (const thread*)a;
+    const thread* y = (const thread*)b;
+    if(x->processIndex != y->processIndex)
+        return (x->processIndex < y->processIndex) ? -1 : 1;
+    if(x->arrTime != y->arrTime)
+        return (x->arrTime < y->arrTime) ? -1 : 1;
+    return (x->TNo < y->TNo) ? -1 : (x->TNo > y->TNo);
+}
+
+/* DEVICE FUNCTIONS */
+
+ioDevice* initializeDevice(int channelAmt, ioSchedule schedule) {
+    ioDevice* d = (ioDevice*)calloc(1, sizeof(ioDevice));
+    d->channelAmt = channelAmt;
+    d->schedule = schedule;
+    d->queue[0] = initializeHeap(0, HEAP_QUEUE);
+    d->queue[1] = initializeHeap(0, HEAP_QUEUE);
+    return d;
+}
+
+// Starts t's I/O of ioTime on a free channel, the caller schedules its completion
+// If every channel is busy the request is queued and false is returned, finishIo schedules it once it gets a channel
+bool requestIo(ioDevice* d, thread* t, int currBurst, int ioTime, int time) {
+    if(d->busy < d->channelAmt) {
+        d->busy++;
+        d->busyTime += ioTime;
+        d->headPos = t->PNo;
+        return true;
+    }
+
+    // FIFO keeps one queue with equal keys, so requests leave in the order they came
+    // The elevator puts requests at or past the head in the direction it is moving into the current sweep, the rest wait for the way back
+    int q = 0;
+    if(d->schedule == IO_ELEVATOR)
+        q = (d->direction == 0) ? (t->PNo < d->headPos) : (t->PNo <= d->headPos);
+    int pos = (d->schedule == IO_FIFO) ? 0 : (q == 0) ? t->PNo : -t->PNo;
+    node n;
+    n.key = ioTime;
+    n.data = t;
+    n.currBurst = currBurst;
+    if(d->queue[q]->nextSeq == UINT_MAX) // Every seq has been handed out, requests never move between the two queues so each is renumbered alone
+        d->queue[q]->nextSeq = renumberSeqs(d->queue[q], 0, 0);
+    insertHeap(d->queue[q], ((unsigned long long)((unsigned int)pos ^ EVENT_SEQ_BIT) << 32) | d->queue[q]->nextSeq++, n);
+    countWaiting(d, time, 1);
+    return false;
+}
+
+// Called when a request finishes at time
+void finishIo(ioDevice* d, heap* h, int time) {
+    if(d->waiting == 0) {
+        d->busy--;
+        return;
+    }
+    if(d->queue[d->direction]->curr_size == 0) // Sweep is done, turn around
+        d->direction ^= 1;
+    node n = removeHeapMin(d->queue[d->direction]);
+    thread* t = (thread*)(n.data);
+    countWaiting(d, time, -1);
+    d->busyTime += n.key;
+    d->headPos = t->PNo;
+    insertItem(h, time + n.key, t, n.currBurst);
+}
+
+void countWaiting(ioDevice* d, int time, int change) {
+    d->waitArea += (long long)d->waiting * (time - d->lastChange);
+    d->lastChange = time;
+    d->waiting += change;
+    d->maxWaiting = max(d->maxWaiting, d->waiting);
+}
+
+void finishDevice(runContext* ctx) {
+    ioDevice* d = ctx->device;
+    if(d == NULL) {
+        return;
+    }
+    ctx->ioBusyTime = d->busyTime;
+    ctx->avgIoQueue = (ctx->totalTime > 0) ? (double)d->waitArea / ctx->totalTime : 0;
+    ctx->maxIoQueue = d->maxWaiting;
+    freeHeap(d->queue[0]);
+    freeHeap(d->queue[1]);
+    free(d);
+    ctx->device = NULL;
+}
+
+/* CHECKPOINT FUNCTIONS */
+
+// Prepares to snapshot a run of the processes to path every interval events
+// Must be closed by caller
+checkpointer* openCheckpoints(char* path, long long interval, process* p, int processAmt) {
+    checkpointer* cp = (checkpointer*)calloc(1, sizeof(checkpointer));
+    cp->path = path;
+    cp->interval = interval;
+    cp->nextAt = interval;
+    cp->processes = p;
+    cp->processAmt = processAmt;
+    cp->threadBase = (int*)malloc((processAmt + 1) * sizeof(int));
+    for(int i = 0; i < processAmt; i++) {
+        cp->threadBase[i] = cp->threadAmt;
+        cp->threadAmt += p[i].threadAmt;
+    }
+    cp->threadTable = (thread**)malloc((cp->threadAmt + 1) * sizeof(thread*));
+    for(int i = 0; i < processAmt; i++) {
+        for(int j = 0; j < p[i].threadAmt; j++) {
+            cp->threadTable[cp->threadBase[i] + j] = &(p[i].threads[j]);
+            cp->burstAmt += p[i].threads[j].burstNo;
+        }
+    }
+    return cp;
+}
+
+// Serializes the whole run into the free buffer and starts writing it out
+// Ready queues are drained and refilled in the same order, which works for every policy without knowing its structure
+void takeCheckpoint(checkpointer* cp, runContext* ctx, heap* h, core* cores, int currentTime) {
+    cp->nextAt = ctx->eventAmt + cp->interval;
+
+    checkpointHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.policyType = ctx->policyType;
+    header.RRTime = ctx->RRTime;
+    header.levelAmt = ctx->levelAmt;
+    memcpy(header.levelQuanta, ctx->levelQuanta, sizeof(header.levelQuanta));
+    header.eventQueueType = ctx->eventQueueType;
+    header.coreAmt = ctx->coreAmt;
+    header.threadSwitch = ctx->threadSwitch;
+    header.processSwitch = ctx->processSwitch;
+    header.processAmt = cp->processAmt;
+    header.threadAmt = cp->threadAmt;
+    header.burstAmt = cp->burstAmt;
+    header.currentTime = currentTime;
+    header.nextSeq = h->nextSeq;
+    header.wheelBase = (h->wheel != NULL) ? h->wheel->base : 0;
+    header.eventQueueAmt = h->curr_size + ((h->wheel != NULL) ? h->wheel->curr_size : 0);
+    for(int i = 0; i < ctx->coreAmt; i++) {
+        header.readyAmt += ctx->sched->size(cores[i].rq);
+    }
+    header.eventAmt = ctx->eventAmt;
+    header.sequence = ++(cp->sequence);
+
+    size_t size = sizeof(checkpointHeader) + cp->threadAmt * sizeof(checkpointThread)
+        + ctx->coreAmt * sizeof(checkpointCore) + header.readyAmt * 2 * sizeof(int) + header.eventQueueAmt * sizeof(checkpointEvent)
+        + 3 * sizeof(long long) + 2 * sizeof(int) + sizeof(quantileSketch) + cp->processAmt * sizeof(int);
+    if(cp->capacity[cp->fill] < size) {
+        cp->capacity[cp->fill] = size + size / 4; // Room for the queues to grow before the next snapshot
+        free(cp->buf[cp->fill]);
+        cp->buf[cp->fill] = (char*)malloc(cp->capacity[cp->fill]);
+    }
+    char* start = cp->buf[cp->fill] + sizeof(checkpointHeader);
+    char* p = start;
+
+    // Threads with their live burst, the bursts themselves never change
+    checkpointThread ct;
+    thread* t;
+    int vals[2];
+    for(int i = 0; i < cp->threadAmt; i++) {
+        t = cp->threadTable[i];
+        ct.s = t->s;
+        ct.finTime = t->finTime;
+        ct.lastCore = t->lastCore;
+        ct.level = t->level;
+        ct.remCpu = t->remCpu;
+        ct.remIo = t->remIo;
+        p = putData(p, &ct, sizeof(ct));
+    }
+
+    // Each core followed by its ready queue in the order it would be popped
+    checkpointCore cc;
+    for(int i = 0; i < ctx->coreAmt; i++) {
+        t = (thread*)(cores[i].current.data);
+        cc.running = cores[i].running;
+        cc.currentEmpty = cores[i].currentEmpty;
+        cc.currentThread = cores[i].running ? cp->threadBase[t->processIndex] + (int)(t - cp->processes[t->processIndex].threads) : -1;
+        cc.currentBurst = cores[i].current.currBurst;
+        cc.currentKey = cores[i].current.key;
+        cc.sliceStart = cores[i].sliceStart;
+        cc.busyUntil = cores[i].busyUntil;
+        cc.busyTime = cores[i].busyTime;
+        cc.prevPNo = cores[i].prevPNo;
+        cc.prevTNo = cores[i].prevTNo;
+        cc.delayAmt = cores[i].delayAmt;
+        cc.readyAmt = ctx->sched->size(cores[i].rq);
+        p = putData(p, &cc, sizeof(cc));
+
+        char* queued = p;
+        for(int j = 0; j < cc.readyAmt; j++) {
+            node n = ctx->sched->pop(cores[i].rq);
+            t = (thread*)(n.data);
+            vals[0] = cp->threadBase[t->processIndex] + (int)(t - cp->processes[t->processIndex].threads);
+            vals[1] = n.currBurst;
+            p = putData(p, vals, sizeof(vals));
+        }
+        for(int j = 0; j < cc.readyAmt; j++) { // Put them back in the same order
+            memcpy(vals, queued + j * sizeof(vals), sizeof(vals));
+            ctx->sched->push(cores[i].rq, cp->threadTable[vals[0]], vals[1]);
+        }
+    }
+
+    // Event queue, in no particular order since every event has a unique sort key
+    checkpointEvent ce;
+    ce.pad = 0;
+    for(int i = 0; i < h->curr_size; i++) {
+        t = (thread*)((h->harr)[i].data);
+        ce.order = h->keys[i + HEAP_PAD];
+        ce.key = (h->harr)[i].key;
+        ce.currBurst = (h->harr)[i].currBurst;
+        ce.thread = cp->threadBase[t->processIndex] + (int)(t - cp->processes[t->processIndex].threads);
+        p = putData(p, &ce, sizeof(ce));
+    }
+    for(int slot = 0; h->wheel != NULL && slot < WHEEL_SIZE; slot++) {
+        for(int e = h->wheel->head[slot]; e != -1; e = h->wheel->pool[e].next) {
+            t = (thread*)(h->wheel->pool[e].n.data);
+            ce.order = h->wheel->pool[e].key;
+            ce.key = h->wheel->pool[e].n.key;
+            ce.currBurst = h->wheel->pool[e].n.currBurst;
+            ce.thread = cp->threadBase[t->processIndex] + (int)(t - cp->processes[t->processIndex].threads);
+            p = putData(p, &ce, sizeof(ce));
+        }
+    }
+
+    // Metrics
+    runMetrics* m = &(ctx->metrics);
+    p = putData(p, &(m->processTurnaround), sizeof(long long));
+    p = putData(p, &(m->waitingTime), sizeof(long long));
+    p = putData(p, &(m->responseTime), sizeof(long long));
+    p = putData(p, &(m->threadsStarted), sizeof(int));
+    p = putData(p, &(m->threadsDone), sizeof(int));
+    p = putData(p, &(m->turnaround), sizeof(quantileSketch));
+    p = putData(p, m->processEnd, cp->processAmt * sizeof(int));
+
+    header.checksum = checksumBytes(start, p - start);
+    memcpy(cp->buf[cp->fill], &header, sizeof(header));
+    cp->len[cp->fill] = p - cp->buf[cp->fill];
+
+    // Hand the buffer to the writer once it's done with the previous one
+    if(cp->writing) {
+        pthread_join(cp->writer, NULL);
+        cp->writing = false;
+    }
+    cp->pending = cp->fill;
+    cp->fill ^= 1;
+    if(pthread_create(&(cp->writer), NULL, checkpointWriter, cp) == 0)
+        cp->writing = true;
+    else
+        checkpointWriter(cp);
+}
+
+// Writes the pending buffer to path.tmp and renames it over path
+// A crash partway through leaves the previous snapshot in place
+void* checkpointWriter(void* arg) {
+    checkpointer* cp = (checkpointer*)arg;
+    char* tmpPath = (char*)malloc(strlen(cp->path) + 5);
+    sprintf(tmpPath, "%s.tmp", cp->path);
+    FILE* out = fopen(tmpPath, "wb");
+    bool written = out != NULL && fwrite(cp->buf[cp->pending], 1, cp->len[cp->pending], out) == cp->len[cp->pending] 
+    && fflush(out) == 0 && fsync(fileno(out)) == 0;
+    if(out != NULL)
+        written = (fclose(out) == 0) && written;
+    if(!written || rename(tmpPath, cp->path) != 0)
+        cp->failed = true;
+    free(tmpPath);
+    return NULL;
+}
+
+// Restores the threads, cores, ready queues, event queue, and metrics of a run from the snapshot at path
+// Returns true without changing anything if there is no snapshot yet, false if it is corrupt or from a different run
+bool resumeCheckpoint(checkpointer* cp, runContext* ctx, heap* h, core* cores) {
+    FILE* in = fopen(cp->path, "rb");
+    if(in == NULL) {
+        if(errno == ENOENT) // Nothing to resume from, start at the beginning
+            return true;
+        fprintf(stderr, "Could not open checkpoint %s.\n", cp->path);
+        return false;
+    }
+    struct stat st;
+    char* data = NULL;
+    size_t len = 0;
+    if(fstat(fileno(in), &st) == 0) {
+        len = (size_t)st.st_size;
+        data = (char*)malloc(len + 1);
+        if(fread(data, 1, len, in) != len)
+            len = 0;
+    }
+    fclose(in);
+
+    checkpointHeader header;
+    char* p = data;
+    char* end = data + len;
+    if(!getData(&p, end, &header, sizeof(header)) || memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0
+    || header.version != CHECKPOINT_VERSION || header.checksum != checksumBytes(p, end - p)) {
+        fprintf(stderr, "Error resuming from %s: not a checkpoint, or it is damaged.\n", cp->path);
+        free(data);
+        return false;
     }
+    if(header.policyType != (int)ctx->policyType || header.RRTime != ctx->RRTime || header.levelAmt != ctx->levelAmt
+    || memcmp(header.levelQuanta, ctx->levelQuanta, ctx->levelAmt * sizeof(int)) != 0 || header.eventQueueType != (int)ctx->eventQueueType
+    || header.coreAmt != ctx->coreAmt || header.threadSwitch != ctx->threadSwitch || header.processSwitch != ctx->processSwitch) {
+        fprintf(stderr, "Error resuming from %s: the checkpoint was taken with different options.\n", cp->path);
+        free(data);
+        return false;
+    }
+    if(header.processAmt != cp->processAmt || header.threadAmt != cp->threadAmt || header.burstAmt != cp->burstAmt) {
+        fprintf(stderr, "Error resuming from %s: the checkpoint was taken with a different input.\n", cp->path);
+        free(data);
+        return false;
+    }
+
+    // The checksum matched, so the counts in the file can be trusted as long as every index stays in range
+    bool valid = true;
+    checkpointThread ct;
+    thread* t;
+    int vals[2];
+    for(int i = 0; i < cp->threadAmt && valid; i++) {
+        t = cp->threadTable[i];
+        valid = getData(&p, end, &ct, sizeof(ct)) && ct.s >= NEW && ct.s <= TERMINATED && ct.lastCore >= -1 && ct.lastCore < ctx->coreAmt
+        && ct.level >= 0 && ct.level < MLFQ_MAX_LEVELS;
+        t->s = (state)ct.s;
+        t->finTime = ct.finTime;
+        t->lastCore = ct.lastCore;
+        t->level = ct.level;
+        t->remCpu = ct.remCpu;
+        t->remIo = ct.remIo;
+    }
+
+    checkpointCore cc;
+    for(int i = 0; i < ctx->coreAmt && valid; i++) {
+        valid = getData(&p, end, &cc, sizeof(cc)) && cc.currentThread >= -1 && cc.currentThread < cp->threadAmt && (cc.running != 0) == (cc.currentThread != -1)
+        && (cc.currentThread == -1 || (cc.currentBurst >= 0 && cc.currentBurst <= cp->threadTable[cc.currentThread]->burstNo))
+        && cc.readyAmt >= 0 && cc.readyAmt <= cp->threadAmt;
+        cores[i].running = cc.running != 0;
+        cores[i].currentEmpty = cc.currentEmpty != 0;
+        cores[i].current.data = (valid && cc.currentThread != -1) ? cp->threadTable[cc.currentThread] : NULL;
+        cores[i].current.currBurst = cc.currentBurst;
+        cores[i].current.key = cc.currentKey;
+        cores[i].sliceStart = cc.sliceStart;
+        cores[i].busyUntil = cc.busyUntil;
+        cores[i].busyTime = cc.busyTime;
+        cores[i].prevPNo = cc.prevPNo;
+        cores[i].prevTNo = cc.prevTNo;
+        cores[i].delayAmt = cc.delayAmt;
+        for(int j = 0; j < cc.readyAmt && valid; j++) {
+            valid = getData(&p, end, vals, sizeof(vals)) && vals[0] >= 0 && vals[0] < cp->threadAmt
+            && vals[1] >= 0 && vals[1] <= cp->threadTable[vals[0]]->burstNo;
+            if(valid)
+                ctx->sched->push(cores[i].rq, cp->threadTable[vals[0]], vals[1]);
+        }
+    }
+
+    // Rebuild the event queue around the saved wheel position, removal order only depends on the sort keys
+    h->curr_size = 0;
+    h->nextSeq = header.nextSeq;
+    if(h->wheel != NULL) {
+        freeWheel(h->wheel);
+        h->wheel = initializeWheel();
+        h->wheel->base = header.wheelBase;
+    }
+    checkpointEvent ce;
+    node n;
+    for(int i = 0; i < header.eventQueueAmt && valid; i++) {
+        valid = getData(&p, end, &ce, sizeof(ce)) && ce.thread >= 0 && ce.thread < cp->threadAmt
+        && ce.currBurst >= 0 && ce.currBurst <= cp->threadTable[ce.thread]->burstNo;
+        if(valid) {
+            n.key = ce.key;
+            n.currBurst = ce.currBurst;
+            n.data = cp->threadTable[ce.thread];
+            insertOrdered(h, ce.order, n);
+        }
+    }
+
+    runMetrics* m = &(ctx->metrics);
+    initializeMetrics(m, cp->processAmt);
+    valid = valid && getData(&p, end, &(m->processTurnaround), sizeof(long long)) && getData(&p, end, &(m->waitingTime), sizeof(long long))
+    && getData(&p, end, &(m->responseTime), sizeof(long long)) && getData(&p, end, &(m->threadsStarted), sizeof(int))
+    && getData(&p, end, &(m->threadsDone), sizeof(int)) && getData(&p, end, &(m->turnaround), sizeof(quantileSketch))
+    && getData(&p, end, m->processEnd, cp->processAmt * sizeof(int)) && p == end;
+    free(data);
+    if(!valid) {
+        fprintf(stderr, "Error resuming from %s: the checkpoint is malformed.\n", cp->path);
+        free(m->processEnd);
+        m->processEnd = NULL;
+        return false;
+    }
+
+    ctx->eventAmt = header.eventAmt;
+    cp->sequence = header.sequence;
+    cp->nextAt = header.eventAmt + cp->interval;
+    cp->resumeTime = header.currentTime;
+    cp->resumed = true;
+    return true;
+}
+
+// Waits for the last snapshot to be written and frees the checkpointer
+bool closeCheckpoints(checkpointer* cp) {
+    bool written = true;
+    if(cp != NULL) {
+        if(cp->writing)
+            pthread_join(cp->writer, NULL);
+        written = !cp->failed;
+        free(cp->buf[0]);
+        free(cp->buf[1]);
+        free(cp->threadBase);
+        free(cp->threadTable);
+        free(cp);
+    }
+    return written;
+}
+
+// 64 bit FNV-1a hash of len bytes, taken 8 bytes at a time since snapshots can be large
+unsigned long long checksumBytes(char* data, size_t len) {
+    unsigned long long hash = 14695981039346656037ULL;
+    unsigned long long word;
+    size_t i = 0;
+    for(; i + sizeof(word) <= len; i += sizeof(word)) {
+        memcpy(&word, data + i, sizeof(word));
+        hash ^= word;
+        hash *= 1099511628211ULL;
+    }
+    for(; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+char* putData(char* p, void* src, size_t len) {
+    memcpy(p, src, len);
+    return p + len;
+}
+
+bool getData(char** p, char* end, void* dst, size_t len) {
+    if((size_t)(end - *p) < len) {
+        return false;
+    }
+    memcpy(dst, *p, len);
+    *p += len;
+    return true;
+}
+
+/* TRACE FUNCTIONS */
+
+// Creates a sink that collects trace output in a large buffer and writes it to out in chunks
+// Text sinks render the same lines as verbose mode, binary sinks write a traceHeader then one traceRecord per transition
+traceSink* openTrace(FILE* out, bool text) {
+    traceSink* s = (traceSink*)malloc(sizeof(traceSink));
+    s->out = out;
+    s->text = text;
+    s->buf = (char*)malloc(TRACE_BUFFER_SIZE);
+    s->len = 0;
+    s->failed = false;
+    if(!text) {
+        traceHeader header;
+        memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+        header.version = TRACE_VERSION;
+        header.recordSize = sizeof(traceRecord);
+        memcpy(s->buf, &header, sizeof(traceHeader));
+        s->len = sizeof(traceHeader);
+    }
+    return s;
+}
+
+// Records a thread moving from one state to another at time
+void traceTransition(traceSink* s, int time, thread* t, state from, state to) {
+    if(s->text) {
+        reserveTrace(s, TRACE_LINE_MAX);
+        char* p = s->buf + s->len;
+        p = traceString(p, "At time ", 8);
+        p = traceInt(p, time);
+        p = traceString(p, ": Thread ", 9);
+        p = traceInt(p, t->TNo);
+        p = traceString(p, " of Process ", 12);
+        p = traceInt(p, t->PNo);
+        p = traceString(p, " moves from ", 12);
+        p = traceString(p, enumString[from], enumLength[from]);
+        p = traceString(p, " to ", 4);
+        p = traceString(p, enumString[to], enumLength[to]);
+        p = traceString(p, ".\n", 2);
+        s->len = p - s->buf;
+    }
+    else {
+        reserveTrace(s, sizeof(traceRecord));
+        traceRecord* r = (traceRecord*)(s->buf + s->len);
+        r->time = time;
+        r->PNo = t->PNo;
+        r->TNo = t->TNo;
+        r->from = (unsigned char)from;
+        r->to = (unsigned char)to;
+        r->pad = 0;
+        s->len += sizeof(traceRecord);
+    }
+}
+
+// Renders a thread's summary the way printThread does
+void traceThread(traceSink* s, thread* t) {
+    reserveTrace(s, TRACE_LINE_MAX);
+    char* p = s->buf + s->len;
+    p = traceString(p, "Thread ", 7);
+    p = traceInt(p, t->TNo);
+    p = traceString(p, " of Process ", 12);
+    p = traceInt(p, t->PNo);
+    p = traceString(p, ":\n\tarrival time: ", 17);
+    p = traceInt(p, t->arrTime);
+    p = traceString(p, "\n\tservice time: ", 16);
+    p = traceInt(p, getTotalServiceTime(t));
+    p = traceString(p, " units, I/O time: ", 18);
+    p = traceInt(p, getTotalIOTime(t));
+    p = traceString(p, " units, turnaround time: ", 25);
+    p = traceInt(p, getTurnaroundTime(t));
+    p = traceString(p, " units, finish time: ", 21);
+    p = traceInt(p, t->finTime);
+    p = traceString(p, " units\n", 7);
+    s->len = p - s->buf;
+}
+
+// Copies len bytes of str to p, returns the end of what was written
+char* traceString(char* p, char* str, size_t len) {
+    memcpy(p, str, len);
+    return p + len;
+}
+
+// Writes num in decimal to p without printf, returns the end of what was written
+char* traceInt(char* p, int num) {
+    char digits[12];
+    char* d = digits + sizeof(digits);
+    unsigned int u = (num < 0) ? 0U - (unsigned int)num : (unsigned int)num;
+    do { // Digits come out backwards
+        *--d = '0' + (u % 10);
+        u /= 10;
+    } while(u != 0);
+    if(num < 0)
+        *--d = '-';
+    return traceString(p, d, digits + sizeof(digits) - d);
+}
+
+// Makes sure there is room for amt more bytes
+void reserveTrace(traceSink* s, size_t amt) {
+    if(s->len + amt > TRACE_BUFFER_SIZE)
+        flushTrace(s);
+}
+
+// Writes everything collected so far
+void flushTrace(traceSink* s) {
+    if(s->len > 0) {
+        if(fwrite(s->buf, 1, s->len, s->out) != s->len) // Full disk or closed pipe, the output is truncated
+            s->failed = true;
+        s->len = 0;
+    }
+}
+
+// Flushes and frees the sink, the output file is left open
+// Returns false if any of the output failed to be written
+bool closeTrace(traceSink* s) {
+    bool written = true;
+    if(s != NULL) {
+        flushTrace(s);
+        written = !s->failed && fflush(s->out) == 0;
+        free(s->buf);
+        free(s);
+    }
+    return written;
+}
+
+// Prints every record of a binary trace file as the line verbose mode would have printed
+bool renderTrace(char* path) {
+    traceHeader header;
+    traceRecord records[4096];
+    size_t amt;
+    thread t;
+    FILE* f = fopen(path, "rb");
+    if(f == NULL) {
+        fprintf(stderr, "Could not open trace file %s.\n", path);
+        return false;
+    }
+    if(fread(&header, sizeof(traceHeader), 1, f) != 1 || memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0
+    || header.version != TRACE_VERSION || header.recordSize != sizeof(traceRecord)) {
+        fprintf(stderr, "%s is not a trace file written by this version.\n", path);
+        fclose(f);
+        return false;
+    }
+
+    traceSink* s = openTrace(stdout, true);
+    while((amt = fread(records, sizeof(traceRecord), 4096, f)) > 0) {
+        for(size_t i = 0; i < amt; i++) {
+            if(records[i].from > TERMINATED || records[i].to > TERMINATED) {
+                fprintf(stderr, "Trace file %s has an invalid record.\n", path);
+                closeTrace(s);
+                fclose(f);
+                return false;
+            }
+            t.PNo = records[i].PNo;
+            t.TNo = records[i].TNo;
+            traceTransition(s, records[i].time, &t, (state)records[i].from, (state)records[i].to);
+        }
+    }
+    bool written = closeTrace(s);
+    fclose(f);
+    if(!written)
+        fprintf(stderr, "Could not write the rendered trace.\n");
+    return written;
+}
+
+/* RESULTS FUNCTIONS */
+
+// Creates the results file at path, as CSV or as a resultsHeader followed by one column per statistic
+resultsSink* openResults(char* path, bool csv) {
+    FILE* out = fopen(path, csv ? "w" : "wb");
+    if(out == NULL) { return NULL; }
+    resultsSink* r = (resultsSink*)calloc(1, sizeof(resultsSink));
+    if(!r) {
+        fclose(out);
+        return NULL;
+    }
+    r->out = out;
+    for(int i = 0; i < RESULT_COLUMNS && !csv; i++) {
+        r->columns[i] = (int*)malloc(RESULTS_BLOCK * sizeof(int));
+        if(!r->columns[i]) {
+            while(i-- > 0) { free(r->columns[i]); }
+            free(r);
+            fclose(out);
+            return NULL;
+        }
+    }
+    if(csv) {
+        r->rows = openTrace(out, true); // Rows are formatted with traceInt into its buffer
+        for(int i = 0; i < RESULT_COLUMNS; i++) {
+            r->rows->len += sprintf(r->rows->buf + r->rows->len, (i == 0) ? "%s" : ",%s", resultNames[i]);
+        }
+        r->rows->buf[r->rows->len++] = '\n';
+    }
+    return r;
+}
+
+// Adds a row for finished thread t
+void recordResult(resultsSink* r, thread* t) {
+    int vals[RESULT_COLUMNS];
+    vals[RESULT_PNO] = t->PNo;
+    vals[RESULT_TNO] = t->TNo;
+    vals[RESULT_ARRIVAL] = t->arrTime;
+    vals[RESULT_FINISH] = t->finTime;
+    vals[RESULT_SERVICE] = getTotalServiceTime(t);
+    vals[RESULT_IO] = getTotalIOTime(t);
+    vals[RESULT_TURNAROUND] = getTurnaroundTime(t);
+    vals[RESULT_WAITING] = vals[RESULT_TURNAROUND] - vals[RESULT_SERVICE] - vals[RESULT_IO]; // Same as recordTermination
+    r->rowAmt++;
+
+    if(r->rows != NULL) {
+        reserveTrace(r->rows, TRACE_LINE_MAX);
+        char* p = r->rows->buf + r->rows->len;
+        for(int i = 0; i < RESULT_COLUMNS; i++) {
+            if(i > 0)
+                *p++ = ',';
+            p = traceInt(p, vals[i]);
+        }
+        *p++ = '\n';
+        r->rows->len = p - r->rows->buf;
+        return;
+    }
+    for(int i = 0; i < RESULT_COLUMNS; i++) {
+        r->columns[i][r->blockLen] = vals[i];
+    }
+    if(++(r->blockLen) == RESULTS_BLOCK)
+        spillResults(r);
+}
+
+// Moves the rows held in memory to the end of each column's temporary file
+// Keeps a columnar sink's memory use fixed however many threads finish, so streamed runs stay bounded
+void spillResults(resultsSink* r) {
+    for(int i = 0; i < RESULT_COLUMNS; i++) {
+        if(r->spill[i] == NULL)
+            r->spill[i] = tmpfile();
+        if(r->spill[i] == NULL || fwrite(r->columns[i], sizeof(int), r->blockLen, r->spill[i]) != (size_t)r->blockLen)
+            r->failed = true;
+    }
+    r->blockLen = 0;
+}
+
+// Adds a row for every thread of every process, in the order they were read
+void recordResults(resultsSink* r, process* p, int processAmt) {
+    for(int i = 0; i < processAmt; i++) {
+        for(int j = 0; j < p[i].threadAmt; j++) {
+            recordResult(r, &(p[i].threads[j]));
+        }
+    }
+}
+
+// Writes the header and columns of a columnar file, or the last CSV rows, then closes the file and frees r
+bool closeResults(resultsSink* r) {
+    bool written = true;
+    if(r->rows != NULL) {
+        written = closeTrace(r->rows);
+    }
+    else {
+        resultsHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, RESULTS_MAGIC, sizeof(header.magic));
+        header.version = RESULTS_VERSION;
+        header.columnAmt = RESULT_COLUMNS;
+        header.rowAmt = r->rowAmt;
+        header.valueSize = sizeof(int);
+        for(int i = 0; i < RESULT_COLUMNS; i++) {
+            strncpy(header.names[i], resultNames[i], RESULTS_NAME_LEN - 1);
+            header.columnOffset[i] = sizeof(resultsHeader) + i * r->rowAmt * (long long)sizeof(int);
+        }
+        fwrite(&header, sizeof(header), 1, r->out);
+        char copy[1 << 16];
+        size_t amt;
+        for(int i = 0; i < RESULT_COLUMNS; i++) {
+            if(r->spill[i] != NULL) { // Rows that were spilled come first
+                rewind(r->spill[i]);
+                while(!r->failed && (amt = fread(copy, 1, sizeof(copy), r->spill[i])) > 0) {
+                    if(fwrite(copy, 1, amt, r->out) != amt)
+                        r->failed = true;
+                }
+                r->failed = r->failed || ferror(r->spill[i]);
+                fclose(r->spill[i]); // Temporary files are deleted on close
+            }
+            if(r->columns[i] != NULL && r->blockLen > 0)
+                fwrite(r->columns[i], sizeof(int), r->blockLen, r->out);
+            free(r->columns[i]);
+        }
+        written = !r->failed;
+    }
+    written = !ferror(r->out) && written;
+    written = (fclose(r->out) == 0) && written;
+    free(r);
+    return written;
+}
+
+/* Core Functions */
+
+// Allocates coreAmt idle cores, each with its own ready queue
+// Must be freed by caller
+core* initializeCores(runContext* ctx) {
+    core* cores = (core*)malloc(ctx->coreAmt * sizeof(core));
+    for(int i = 0; i < ctx->coreAmt; i++) {
+        cores[i].rq = ctx->sched->createQueue();
+        cores[i].running = false;
+        cores[i].currentEmpty = false;
+        cores[i].sliceStart = 0;
+        cores[i].busyUntil = 0;
+        cores[i].busyTime = 0;
+        cores[i].prevPNo = -1;
+        cores[i].prevTNo = -1;
+        cores[i].delayAmt = 0;
+    }
+    return cores;
+}
+
+// Chooses the core a thread that just became ready is queued on
+// Prefers the core it last ran on if idle, then any idle core, then the core it last ran on, then the shortest ready queue
+SIM_INLINE int pickCore(runContext* ctx, core* cores, thread* t, loopKind kind) {
+    int coreAmt = ctx->coreAmt;
+    if(coreAmt == 1) {
+        return 0;
+    }
+    if(ctx->processCore != NULL) { // Partitioned, the process never leaves its core
+        return ctx->processCore[t->processIndex];
+    }
+    if(t->lastCore != -1 && !cores[t->lastCore].running) {
+        return t->lastCore;
+    }
+    for(int i = 0; i < coreAmt; i++) {
+        if(!cores[i].running)
+            return i;
+    }
+    if(t->lastCore != -1) {
+        return t->lastCore;
+    }
+
+    int shortest = 0;
+    for(int i = 1; i < coreAmt; i++) {
+        if(readySize(ctx, cores[i].rq, kind) < readySize(ctx, cores[shortest].rq, kind))
+            shortest = i;
+    }
+    return shortest;
+}
+
+// Finds the core with the longest ready queue for core c to steal from
+// Returns -1 if every other ready queue is empty, or if the run is partitioned
+SIM_INLINE int findVictim(runContext* ctx, core* cores, int c, loopKind kind) {
+    int victim = -1;
+    int size;
+    int victimSize = 0;
+    if(ctx->processCore != NULL) {
+        return -1;
+    }
+    for(int i = 0; i < ctx->coreAmt; i++) {
+        size = (i != c) ? readySize(ctx, cores[i].rq, kind) : 0;
+        if(size > victimSize) {
+            victim = i;
+            victimSize = size;
+        }
+    }
+    return victim;
+}
+
+// Starts the next slice on core c at time, stealing the front of the longest other ready queue if its own is empty
+// The core idles if there is nothing to run anywhere
+SIM_INLINE void dispatchCore(runContext* ctx, core* cores, int c, int time, loopKind kind, bool traced) {
+    core* cpu = &(cores[c]);
+    void* rq = cpu->rq;
+    if(readySize(ctx, rq, kind) == 0) {
+        int victim = findVictim(ctx, cores, c, kind);
+        if(victim == -1) { // Core is idle, no previous process
+            cpu->running = false;
+            cpu->prevPNo = -1;
+            cpu->prevTNo = -1;
+            cpu->delayAmt = 0;
+            return;
+        }
+        rq = cores[victim].rq;
+    }
+
+    node n = popReady(ctx, rq, kind); // get the next thread the policy picks
+    thread* t = (thread*)(n.data);
+    bool firstRun = (t->lastCore == -1);
+    t->lastCore = c;
+
+    // Update context switch based on last process' info
+    if( cpu->prevPNo != -1 && (cpu->prevPNo != t->PNo || cpu->prevTNo != t->TNo)) { 
+        if( cpu->prevPNo == t->PNo ) { // Current thread is from the same process
+            cpu->delayAmt = ctx->threadSwitch;
+            STAT_INC(threadSwitches);
+        }
+        else { // Current thread is from a different process
+            cpu->delayAmt = ctx->processSwitch;
+            STAT_INC(processSwitches);
+        }
+    }
+    cpu->prevPNo = t->PNo;
+    cpu->prevTNo = t->TNo;
+    time += cpu->delayAmt; // Add time for prev context switch
+    if(firstRun)
+        recordFirstRun(&(ctx->metrics), t, time);
+
+    // Set state of current thread to running
+    if(t->s != RUNNING)
+        stateSwitch(ctx, t, RUNNING, time, traced);
+
+    // Add time to process thread
+    int timeInCpu = consumeTime(ctx, &n, &(cpu->currentEmpty), kind);
+    cpu->busyTime += timeInCpu;
+    cpu->sliceStart = time;
+    cpu->busyUntil = time + timeInCpu;
+    cpu->current = n;
+    cpu->running = true;
+}
+
+// Preempts the slice running on core c at time if the front of its ready queue has less CPU time left in its burst
+// The unused part of the slice is given back to the preempted thread, which goes back in the ready queue
+SIM_INLINE void preemptCore(runContext* ctx, core* cores, int c, int time, loopKind kind, bool traced) {
+    core* cpu = &(cores[c]);
+    node n = cpu->current;
+    thread* t = (thread*)(n.data);
+    int unused = cpu->busyUntil - max(time, cpu->sliceStart);
+    if(readyHeapMinKey((heap*)cpu->rq) >= unused + t->remCpu) {
+        return;
+    }
+
+    t->remCpu += unused;
+    cpu->busyTime -= unused;
+    stateSwitch(ctx, t, READY, time, traced);
+    pushReady(ctx, cpu->rq, t, n.currBurst, kind);
+    STAT_MAX(maxReadyQueue, readySize(ctx, cpu->rq, kind));
+    dispatchCore(ctx, cores, c, time, kind, traced);
+}
+
+// Frees every core and its ready queue
+void freeCores(runContext* ctx, core* cores) {
+    if(cores != NULL) {
+        for(int i = 0; i < ctx->coreAmt; i++) {
+            ctx->sched->freeQueue(cores[i].rq);
+        }
+        free(cores);
+    }
+}
+
+/* Policy Functions */
+
+// Points ctx at the policy's functions
+// Returns false if a round robin quantum was given to a policy that doesn't use it
+bool setPolicy(runContext* ctx, policyType type) {
+    if(type != POLICY_FIFO && ctx->RRTime != 0) {
+        return false;
+    }
+    ctx->policyType = type;
+    ctx->sched = &(policies[type]);
+    return true;
+}
+
+// Ready queue operations for the simulation loop
+// FIFO loops call the ring buffer directly so they can be inlined, other policies go through their function pointers
+SIM_INLINE void pushReady(runContext* ctx, void* rq, thread* t, int currBurst, loopKind kind) {
+    if(kind == LOOP_POLICY)
+        ctx->sched->push(rq, t, currBurst);
+    else
+        pushReadyQueue((readyQueue*)rq, t, currBurst);
+}
+
+SIM_INLINE node popReady(runContext* ctx, void* rq, loopKind kind) {
+    return (kind == LOOP_POLICY) ? ctx->sched->pop(rq) : popReadyQueue((readyQueue*)rq);
+}
+
+SIM_INLINE int readySize(runContext* ctx, void* rq, loopKind kind) {
+    return (kind == LOOP_POLICY) ? ctx->sched->size(rq) : ((readyQueue*)rq)->curr_size;
+}
+
+// Parses MLFQ quanta like 8,16,0 into ctx, one level per value
+bool parseLevels(char* arg, runContext* ctx) {
+    int quanta[MLFQ_MAX_LEVELS];
+    int levelAmt = 0;
+    int used;
+    while(levelAmt < MLFQ_MAX_LEVELS && sscanf(arg, "%d%n", &(quanta[levelAmt]), &used) == 1 && quanta[levelAmt] >= 0) {
+        levelAmt++;
+        arg += used;
+        if(*arg != ',')
+            break;
+        arg++;
+    }
+    if(levelAmt == 0 || *arg != '\0') {
+        return false;
+    }
+
+    ctx->levelAmt = levelAmt;
+    memcpy(ctx->levelQuanta, quanta, levelAmt * sizeof(int));
+    return true;
+}
+
+// FCFS and round robin use a ring buffer, O(1) per push and pop
+void* createFifoQueue(void) {
+    return initializeReadyQueue();
+}
+
+void pushFifoQueue(void* rq, thread* t, int currBurst) {
+    pushReadyQueue((readyQueue*)rq, t, currBurst);
+}
+
+node popFifoQueue(void* rq) {
+    return popReadyQueue((readyQueue*)rq);
+}
+
+int fifoQueueSize(void* rq) {
+    return ((readyQueue*)rq)->curr_size;
+}
+
+void freeFifoQueue(void* rq) {
+    freeReadyQueue((readyQueue*)rq);
+}
+
+// Round robin quantum, 0 for FCFS
+int fifoQuantum(runContext* ctx, thread* t) {
+    return ctx->RRTime;
+}
+
+// SJF, SRTF, and priority use the event heap's array, O(log n) per push and pop
+void* createReadyHeap(void) {
+    return initializeHeap(0, HEAP_QUEUE);
+}
+
+void pushShortest(void* rq, thread* t, int currBurst) {
+    pushReadyHeap((heap*)rq, t->remCpu, t, currBurst);
+}
+
+void pushPriority(void* rq, thread* t, int currBurst) {
+    pushReadyHeap((heap*)rq, t->priority, t, currBurst);
+}
+
+// Orders by key, then by push order so equal keys are served first come first serve
+void pushReadyHeap(heap* h, int key, thread* t, int currBurst) {
+    node n;
+    n.key = key;
+    n.data = t;
+    n.currBurst = currBurst;
+    if(h->nextSeq == UINT_MAX) // Every seq has been handed out
+        h->nextSeq = renumberSeqs(h, 0, 0);
+    insertHeap(h, ((unsigned long long)((unsigned int)key ^ EVENT_SEQ_BIT) << 32) | h->nextSeq++, n); // Flipping the sign bit sorts negative keys first
+}
+
+node popReadyHeap(void* rq) {
+    return removeHeapMin((heap*)rq);
+}
+
+int readyHeapSize(void* rq) {
+    return ((heap*)rq)->curr_size;
+}
+
+// Returns the smallest key in the ready heap, INT_MAX if it is empty
+int readyHeapMinKey(heap* h) {
+    if(h->curr_size == 0) {
+        return INT_MAX;
+    }
+    return h->harr[0].key;
+}
+
+void freeReadyHeap(void* rq) {
+    freeHeap((heap*)rq);
+}
+
+// SJF, SRTF, and priority always run the rest of the burst, SRTF is cut short by preemptCore
+int wholeBurst(runContext* ctx, thread* t) {
+    return 0;
+}
+
+// MLFQ keeps a ring buffer per level and a bitmask of the levels holding threads, O(1) per push and pop
+void* createMlfqQueue(void) {
+    mlfqQueue* q = (mlfqQueue*)malloc(sizeof(mlfqQueue));
+    for(int i = 0; i < MLFQ_MAX_LEVELS; i++) {
+        q->levels[i] = NULL; // Created when first used
+    }
+    q->nonEmpty = 0;
+    q->curr_size = 0;
+    return q;
+}
+
+void pushMlfqQueue(void* rq, thread* t, int currBurst) {
+    mlfqQueue* q = (mlfqQueue*)rq;
+    if(q->levels[t->level] == NULL) {
+        q->levels[t->level] = initializeReadyQueue();
+    }
+    pushReadyQueue(q->levels[t->level], t, currBurst);
+    q->nonEmpty |= 1U << t->level;
+    q->curr_size++;
+}
+
+node popMlfqQueue(void* rq) {
+    mlfqQueue* q = (mlfqQueue*)rq;
+    int level = __builtin_ctz(q->nonEmpty); // Highest level with threads
+    node n = popReadyQueue(q->levels[level]);
+    if(isReadyQueueEmpty(q->levels[level]))
+        q->nonEmpty &= ~(1U << level);
+    q->curr_size--;
+    return n;
+}
+
+int mlfqQueueSize(void* rq) {
+    return ((mlfqQueue*)rq)->curr_size;
+}
+
+void freeMlfqQueue(void* rq) {
+    mlfqQueue* q = (mlfqQueue*)rq;
+    for(int i = 0; i < MLFQ_MAX_LEVELS; i++) {
+        freeReadyQueue(q->levels[i]);
+    }
+    free(q);
+}
+
+// Quantum of the thread's current level
+int mlfqQuantum(runContext* ctx, thread* t) {
+    return ctx->levelQuanta[t->level];
+}
+
+// A thread that used its whole quantum is moved down a level, the last level keeps it
+void mlfqExpire(runContext* ctx, thread* t) {
+    if(t->level < ctx->levelAmt - 1)
+        t->level++;
 }
@@ -6,93 +6,771 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "simcpu.h"
+
+#ifndef HEAP_ARITY
+#define HEAP_ARITY 4 // Children per event heap node, override with -DHEAP_ARITY=8
+#endif
+#define HEAP_PAD (HEAP_ARITY - 1) // keys[] offset so each group of siblings starts on a HEAP_ARITY*8 byte boundary
+
+#define READY_PREFETCH 8 // How many pops ahead the ready queue prefetches a thread
+#define INPUT_BLOCK_SIZE (1 << 20) // Bytes read from a non-mappable input at a time
+#define ARENA_BLOCK_SIZE (1 << 20) // Bytes per arena block, larger allocations get their own block
+
+#define EVENT_SEQ_BIT (1U << 31) // Set in the seq of every non-arrival event so arrivals sort first among simultaneous events
+
+#define TRACE_BUFFER_SIZE (1 << 20) // Bytes a trace sink collects before writing them out
+#define TRACE_LINE_MAX 256 // Longest line the text rendering can produce
+#define TRACE_MAGIC "SIMCPUTR"
+#define TRACE_VERSION 1
+
+#define RESULTS_MAGIC "SIMCPURS"
+#define RESULTS_VERSION 1
+#define RESULTS_NAME_LEN 16
+#define RESULTS_BLOCK 16384 // Rows of each column a columnar results sink holds in memory before spilling them to a temporary file
+
+#define CHECKPOINT_MAGIC "SIMCPUCK"
+#define CHECKPOINT_VERSION 3
+#define CHECKPOINT_INTERVAL 100000000LL // Events between snapshots unless --checkpoint-every is given
+
+#define BENCH_PHASES 4 // Phases timed by --bench
+#define BENCH_PARSE 0
+#define BENCH_HEAP 1
+#define BENCH_LOOP 2
+#define BENCH_STATS 3
+
+// Hot path counters for --stats, only built with -DSIM_STATS so normal builds pay nothing for them
+#ifdef SIM_STATS
+typedef struct {
+    long long inserts; // Events added by insertItem and insertArrival
+    long long removes; // removeMin calls
+    long long upheapSteps; // Levels moved by upheap, in the event queue and ready heaps
+    long long downheapSteps;
+    int maxEventQueue; // Most events waiting at once, heap and wheel together
+    int maxEventHeap; // Most events in the heap array at once
+    int maxReadyQueue; // Longest ready queue of any core
+    long long threadSwitches; // Context switches between threads of the same process
+    long long processSwitches;
+} simStats;
+extern __thread simStats stats; // Per thread so sweep workers and library callers never share counters
+#define STAT_INC(field) (stats.field++)
+#define STAT_MAX(field, val) (stats.field = max(stats.field, (val)))
+#else
+#define STAT_INC(field) ((void)0)
+#define STAT_MAX(field, val) ((void)0)
+#endif
+
+#define WHEEL_BITS 12
+#define WHEEL_SIZE (1 << WHEEL_BITS) // Time units covered by the timing wheel, one slot per time unit
 
 typedef enum {
     NEW, READY, RUNNING, BLOCKED, TERMINATED
 } state;
 
+// One burst as read from the input, never written by the simulation so loaded workloads can be shared between runs
 typedef struct {
-    int burstNo;
     int cpuTime;
     int ioTime;
-    int currCpuTime;
-    int currIoTime;
 } cpuBurst;
 
 typedef struct {
-    int arrTime; // Arrival Time
-    int finTime; // Finish Time
     int PNo; // Process Number
     int TNo; // Thread Number
-    int burstNo; // Number of bursts
-    cpuBurst** bursts;
+    int processIndex; // Position of the thread's process in the input
     state s;
+    int burstNo; // Number of bursts
+    int remCpu; // CPU time left in the current burst, the only burst state the simulation loop writes
+    int remIo; // IO time left in the current burst
+    int lastCore; // Core the thread last ran on, -1 if it hasn't run yet
+    cpuBurst* bursts; // Contiguous array of burstNo bursts
+    int arrTime; // Arrival Time
+    int finTime; // Finish Time
+    int priority; // Static priority of its process, lower runs first
+    int level; // Current MLFQ level
+    int serviceTime; // Total CPU time of every burst, summed when the thread is loaded
+    int ioTime; // Total IO time of every burst
 } thread;
 
 typedef struct {
-    thread** threads;
+    thread* threads; // Contiguous array of threadAmt threads
     int threadAmt; // # of threads in the threads array
 } process;
 
+typedef struct {
+    char* buf;
+    size_t len; // Bytes of valid data in buf
+    size_t pos; // Next byte to be read
+    int fd; // Refills come from here when not mapped, kept open either way until closeInput
+    bool mapped; // buf is an mmap of the whole input file
+} inputReader;
+
+#define WORKLOAD_MAGIC "SIMCPUWL" // First 8 bytes of a binary workload file
+#define WORKLOAD_VERSION 4
+
+// Header of a binary workload, followed by the process, thread, and burst tables
+// Tables hold the in-memory structs, with the threads and bursts pointers stored as byte offsets from the start of the file
+typedef struct {
+    char magic[8];
+    int version;
+    int processAmt;
+    int threadSwitch;
+    int processSwitch;
+    int processSize; // sizeof() of each table's records, a file from a build with a different layout is rejected
+    int threadSize;
+    int burstSize;
+    int pad;
+    long long threadAmt;
+    long long burstAmt;
+    long long processTable; // Byte offset of each table
+    long long threadTable;
+    long long burstTable;
+} workloadHeader;
+
+typedef struct {
+    thread t; // Must be first, the simulation only sees &t
+    cpuBurst bursts[];
+} streamedThread;
+
+typedef struct {
+    inputReader* in;
+    int processAmt;
+    int processesRead;
+    int pNum; // Process number of the process currently being read
+    int threadsRead; // Threads read from the current process
+    int threadAmt; // Threads in the current process
+    int priority; // Priority of the current process
+    thread* next; // Next thread to arrive, already read, NULL at the end of the input
+    unsigned int arrivalNo; // Arrivals handed to the event queue so far
+    bool failed; // Input was malformed partway through the simulation
+} arrivalStream;
+
+typedef struct {
+    int time;
+    int PNo;
+    int TNo;
+    unsigned char from; // state before the transition
+    unsigned char to;
+    unsigned short pad;
+} traceRecord; // Fixed size record written by a binary trace sink
+
+typedef struct {
+    char magic[8]; // TRACE_MAGIC
+    int version;
+    int recordSize; // sizeof(traceRecord)
+} traceHeader;
+
+typedef struct {
+    FILE* out;
+    bool text; // Renders lines like -v instead of writing traceRecords
+    char* buf;
+    size_t len;
+    bool failed; // A write came up short, so the output is truncated
+} traceSink; // One per run, so concurrent runs never share a buffer
+
+typedef enum {
+    RESULT_PNO, RESULT_TNO, RESULT_ARRIVAL, RESULT_FINISH, RESULT_SERVICE, RESULT_IO, RESULT_TURNAROUND, RESULT_WAITING, RESULT_COLUMNS
+} resultColumn;
+
+// Starts a results file, each column follows it as rowAmt ints in the order of columnOffset
+typedef struct {
+    char magic[8]; // RESULTS_MAGIC
+    int version;
+    int columnAmt; // RESULT_COLUMNS
+    long long rowAmt; // One row per thread
+    int valueSize; // sizeof(int)
+    int pad;
+    char names[RESULT_COLUMNS][RESULTS_NAME_LEN]; // Same names as the CSV header line
+    long long columnOffset[RESULT_COLUMNS]; // Byte offset of each column
+} resultsHeader;
+
+// Collects one row per finished thread for --results
+// CSV rows are rendered into a trace sink's buffer as they come
+// Columns are gathered in one temporary file each, and joined behind the header when the file is closed
+typedef struct {
+    FILE* out;
+    traceSink* rows; // CSV only
+    int* columns[RESULT_COLUMNS]; // Columnar only, the last blockLen rows of each column
+    FILE* spill[RESULT_COLUMNS]; // Columnar only, earlier rows of each column, NULL until the first block is spilled
+    int blockLen;
+    long long rowAmt;
+    bool failed; // A temporary file couldn't be created or written
+} resultsSink;
+
+typedef struct arenaBlock {
+    struct arenaBlock* next; // Previously filled block
+    size_t used;
+    size_t size;
+    char data[];
+} arenaBlock;
+
+typedef struct {
+    arenaBlock* head; // Block currently being carved, older blocks are chained behind it
+} arena;
+
 typedef struct {
     int key;
-    void* data;
     int currBurst; // IS AN INDEX, ADD +1 WHEN COMPARING TO BURSTNO IN A THREAD
+    void* data;
 } node;
 
 typedef struct {
-    node** harr;
+    unsigned long long key; // Packed (time << 32 | seq), same as the heap's sort keys
+    node n;
+    int next; // Index of the next entry in the same slot, -1 if last
+} wheelEntry;
+
+typedef struct {
+    int head[WHEEL_SIZE]; // First entry of each slot's FIFO, -1 if the slot is empty
+    int tail[WHEEL_SIZE]; // Last entry of each slot's FIFO
+    unsigned long long occupied[WHEEL_SIZE / 64]; // One bit per non-empty slot
+    wheelEntry* pool; // Entries for every event in the wheel, unused ones are chained on freeList
+    int poolCapacity;
+    int freeList;
+    int base; // Time of the last removed event, slots cover [base, base + WHEEL_SIZE)
+    int minSlot; // Cached slot of the earliest event, -1 if it must be searched for
     int curr_size;
+} timingWheel;
+
+typedef enum {
+    HEAP_QUEUE, WHEEL_QUEUE
+} queueType;
+
+typedef struct {
+    unsigned long long* keys; // Packed (time << 32 | seq) sort keys, kept apart from harr so sifts only touch keys
+    node* harr; // Nodes are stored inline, grows geometrically and never shrinks
+    int curr_size;
+    int capacity;
+    unsigned int nextSeq; // Insertion counter, breaks ties between simultaneous events in FIFO order, renumbered before it wraps
+    timingWheel* wheel; // Holds events within WHEEL_SIZE of the current time when set, the heap holds the rest
 } heap;
 
+typedef struct {
+    node* buf; // Ring buffer of waiting threads, capacity is always a power of 2
+    int head; // Index of the front of the queue
+    int curr_size;
+    int capacity;
+} readyQueue;
+
+typedef struct {
+    readyQueue* levels[MLFQ_MAX_LEVELS]; // One FIFO per level, level 0 runs first
+    unsigned int nonEmpty; // Bit per level with threads in it
+    int curr_size;
+} mlfqQueue;
 
-heap* initializePriorityQueue(process*** p, int* processAmt, int* threadSwitch, int* processSwitch) ;
-thread** createThreadList( int pNum, int tAmt );
-cpuBurst** createBurstList(int burstAmt, int tNum);
-bool validateLineEnding();
-int consumeTime(node* n, bool* emptyFlag);
-void parseNextEvent(heap* h, heap* rq);
+typedef struct {
+    void* rq; // Ready queue owned by the policy
+    bool running; // A slice is in progress, cores that aren't running always have an empty ready queue
+    node current; // Thread in the slice that is running
+    bool currentEmpty; // The running slice uses up the rest of the current burst's CPU time
+    int sliceStart; // Time the running slice started, after the context switch
+    int busyUntil; // Time the running slice ends, this core's clock
+    int busyTime; // Time spent running threads
+    int prevPNo; // Last thread run on this core, -1 after the core idles
+    int prevTNo;
+    int delayAmt; // Context switch time added before the next slice
+} core;
+
+#define REPLAY_COMM_LEN 16 // Kernel task names are at most 15 characters
+#define REPLAY_LINE_LEN 512 // Longer scheduler log lines are cut off, sched events are far shorter
+#define REPLAY_RELEASE_SIZE (64 << 20) // Bytes of a mapped scheduler log read between releasing its pages
+
+typedef enum {
+    LOG_SWITCH, LOG_WAKEUP, LOG_EXIT, LOG_OTHER
+} schedEventType;
+
+// One line of a perf sched script or ftrace log
+typedef struct {
+    schedEventType type;
+    long long time; // Nanoseconds
+    int pid; // Task switched out, woken, or exiting, 0 for the idle task
+    char comm[REPLAY_COMM_LEN];
+    char prevState; // First letter of the switched out task's state, R if it was preempted
+    int nextPid; // Task switched in
+    char nextComm[REPLAY_COMM_LEN];
+} schedEvent;
+
+// A thread being rebuilt from a scheduler log, until it exits or the log ends
+typedef struct {
+    state s; // READY, RUNNING or BLOCKED
+    long long since; // Time it was last switched in or blocked
+    long long arrTime; // Time it was first seen runnable or running
+    long long cpu; // CPU time of the burst in progress
+    cpuBurst* bursts; // Bursts ended by blocking, grown as needed
+    int burstAmt;
+    int burstCap;
+    int group; // Process it is replayed as, one per command name
+    int seq; // Order threads were first seen in
+} replayThread;
+
+// State of a scheduler log being read, memory grows with the live threads and finished bursts but never with the log itself
+typedef struct {
+    arena* a;
+    long long unit; // Nanoseconds per simulated time unit
+    long long base; // Time of the first event in nanoseconds
+    bool started;
+    long long now; // Time of the latest event in units
+    replayThread** byPid; // Live threads indexed by pid
+    int pidCap;
+    char (*groups)[REPLAY_COMM_LEN]; // Command name of each process, in the order they were first seen
+    int groupAmt;
+    int groupCap;
+    int* groupTable; // Open addressing table of group indices by command name hash, -1 if empty
+    int groupTableCap;
+    thread* done; // Finished threads, their bursts are already in the arena
+    int doneAmt;
+    int doneCap;
+    int threadsSeen;
+} replayLog;
+
+#define SKETCH_SUB_BITS 5 // Each power of two range of a quantileSketch is split into 2^SKETCH_SUB_BITS buckets
+#define SKETCH_BUCKETS ((32 - SKETCH_SUB_BITS) << SKETCH_SUB_BITS) // Enough for any non-negative int
+
+// Log-linear histogram of non-negative values, quantiles are within 1/2^SKETCH_SUB_BITS of the exact value
+// Values below 2^SKETCH_SUB_BITS are kept exactly
+typedef struct {
+    long long counts[SKETCH_BUCKETS];
+    long long total;
+} quantileSketch;
+
+// Statistics accumulated as threads arrive, start, and terminate, so reporting never rescans the threads
+typedef struct {
+    int* processEnd; // Latest finish of each process' threads so far, starts at its first arrival, -1 until then
+    int processAmt;
+    long long processTurnaround; // Summed over processes, last finish minus first arrival
+    long long waitingTime; // Summed over terminated threads, turnaround minus service and IO time
+    long long responseTime; // Summed over started threads, first time on a CPU minus arrival
+    int threadsStarted;
+    int threadsDone;
+    quantileSketch turnaround; // Thread turnaround times
+} runMetrics;
+
+typedef enum {
+    IO_FIFO, IO_ELEVATOR
+} ioSchedule;
+
+// I/O device shared by every thread, a thread that blocks while every channel is busy waits in the device's queue
+// Elevator order treats each process number as a position on the device and sweeps the queue up and down across it
+typedef struct {
+    int channelAmt;
+    int busy; // Channels serving a request, every channel is busy whenever requests are waiting
+    ioSchedule schedule;
+    heap* queue[2]; // Waiting requests, [0] is the FIFO or the upward sweep keyed by PNo, [1] the downward sweep keyed by -PNo
+    int direction; // Queue the elevator is sweeping
+    int headPos; // Position of the last request started
+    int waiting; // Requests in both queues
+    int maxWaiting;
+    long long waitArea; // Waiting requests summed over every time unit
+    int lastChange; // Time waiting last changed
+    long long busyTime; // Channel time spent serving requests
+} ioDevice;
+
+// Variants of the simulation loop, each one is compiled with the checks that can't change during its runs folded away
+typedef enum {
+    LOOP_FCFS, // FIFO policy without a quantum, ready queue calls go straight to the ring buffer
+    LOOP_ROUND_ROBIN, // FIFO policy with ctx->RRTime as its quantum
+    LOOP_POLICY // Any policy, through its function pointers
+} loopKind;
+#define SIM_INLINE static inline __attribute__((always_inline)) // Copied into each loop variant so its kind and traced arguments become constants
+
+struct runContext;
+
+// Header of a checkpoint file, followed by the threads, cores and their ready queues, event queue, and metrics
+// Threads are stored by their position in the input, counting across processes
+typedef struct {
+    char magic[8]; // CHECKPOINT_MAGIC
+    int version;
+    int policyType; // Options the run was started with, a resumed run must use the same ones
+    int RRTime;
+    int levelAmt;
+    int levelQuanta[MLFQ_MAX_LEVELS];
+    int eventQueueType;
+    int coreAmt;
+    int threadSwitch;
+    int processSwitch;
+    int processAmt; // Shape of the workload, checked against the input on resume
+    int threadAmt;
+    long long burstAmt;
+    int currentTime;
+    unsigned int nextSeq; // Event queue insertion counter
+    int wheelBase;
+    int eventQueueAmt; // Events waiting in the heap and wheel
+    int readyAmt; // Threads waiting in every core's ready queue
+    int pad;
+    long long eventAmt;
+    unsigned long long sequence; // Snapshots taken during the run, including ones before a resume
+    unsigned long long checksum; // FNV-1a of everything after the header
+} checkpointHeader;
+
+typedef struct {
+    int running;
+    int currentEmpty;
+    int currentThread; // -1 if the core isn't running
+    int currentBurst;
+    int currentKey;
+    int sliceStart;
+    int busyUntil;
+    int busyTime;
+    int prevPNo;
+    int prevTNo;
+    int delayAmt;
+    int readyAmt; // Ready queue entries that follow the core, in the order they are popped
+} checkpointCore;
+
+typedef struct {
+    unsigned long long order; // Packed sort key
+    int key;
+    int currBurst;
+    int thread;
+    int pad;
+} checkpointEvent;
+
+typedef struct {
+    int s;
+    int finTime;
+    int lastCore;
+    int level;
+    int remCpu;
+    int remIo;
+} checkpointThread;
+
+// Takes snapshots of a run every interval events and writes them out on a background thread
+// Two buffers let the next snapshot be filled while the previous one is still being written
+typedef struct {
+    char* path; // Snapshots are written to path.tmp and renamed over path, so path always holds a whole one
+    long long interval;
+    long long nextAt; // eventAmt at which the next snapshot is taken
+    process* processes;
+    int processAmt;
+    int threadAmt;
+    long long burstAmt;
+    int* threadBase; // Position of each process' first thread
+    thread** threadTable; // Every thread by position
+    char* buf[2];
+    size_t capacity[2];
+    size_t len[2];
+    int fill; // Buffer the next snapshot goes into, the other may still be being written
+    int pending; // Buffer the writer thread is writing
+    pthread_t writer;
+    bool writing; // writer has been started and not joined
+    bool failed; // A snapshot couldn't be written
+    unsigned long long sequence;
+    bool resumed; // The run continues from a snapshot instead of the start
+    int resumeTime;
+} checkpointer;
+
+// A scheduling policy, each one owns the structure of its cores' ready queues
+typedef struct {
+    char* name; // Printed in the statistics
+    void* (*createQueue)(void);
+    void (*push)(void* rq, thread* t, int currBurst);
+    node (*pop)(void* rq); // Removes the thread that runs next
+    int (*size)(void* rq);
+    void (*freeQueue)(void* rq);
+    int (*quantum)(struct runContext* ctx, thread* t); // Longest slice t can run for, 0 runs the rest of its burst
+    void (*expire)(struct runContext* ctx, thread* t); // Called when t uses its whole quantum without finishing its burst, may be NULL
+    bool preemptive; // A thread that becomes ready can preempt a running one with more CPU time left in its burst
+} policy;
+
+typedef struct runContext {
+    bool detailed; // -d
+    bool verbose; // -v
+    int RRTime; // -r time quantum, 0 for FCFS
+    policyType policyType; // -p
+    policy* sched;
+    int levelAmt; // MLFQ levels and their quanta, --levels
+    int levelQuanta[MLFQ_MAX_LEVELS];
+    queueType eventQueueType; // -q
+    int coreAmt; // -c
+    traceSink* textTrace; // -v, NULL when off
+    traceSink* binaryTrace; // --trace, NULL when off
+    resultsSink* results; // --results of a streamed run, whose threads are recorded as they finish
+    bool fastForward; // Finish slices without going through the event loop when nothing else can happen first, --no-fast-forward
+    int threadSwitch;
+    int processSwitch;
+
+    // Results of the run
+    int totalTime;
+    int busyTime; // Summed over every core
+    long long eventAmt; // Events delivered plus slices finished
+    double avgTurnaround; // Per process
+    double avgWaiting; // Per thread
+    double avgResponse; // Per thread
+    int turnaroundPercentiles[3]; // p50, p95, and p99 thread turnaround
+    runMetrics metrics;
+    checkpointer* checkpoint; // --checkpoint, NULL when off
+    int* processCore; // --partition, core each process is pinned to by processIndex, NULL lets threads run on any core
+    int ioChannels; // --io-channels, 0 lets every blocked thread do its I/O at once
+    ioSchedule ioSchedule; // --io-sched
+    ioDevice* device; // Created for each run when ioChannels is set, NULL otherwise
+    long long ioBusyTime; // Summed over every channel
+    double avgIoQueue; // Requests waiting for a channel, averaged over the run
+    int maxIoQueue;
+} runContext;
+
+struct workload {
+    arena* a; // Holds every process, thread, and burst
+    inputReader* in; // Kept open since binary workloads point into its mapping
+    process* processes;
+    int processAmt;
+    int threadSwitch;
+    int processSwitch;
+    bool dirty; // Has been run since the last reset
+};
+
+typedef enum {
+    SWEEP_QUANTUM, SWEEP_THREAD_SWITCH, SWEEP_PROCESS_SWITCH
+} sweepParam;
+#define SWEEP_PARAMS 3
+
+typedef struct {
+    process* processes; // Parsed once and only read by the workers
+    int processAmt;
+    runContext* runs; // One per configuration, results are written back in place
+    int runAmt;
+    int nextRun; // Next run to hand out to a worker
+} sweep;
+
+// A partitioned run split into one single core run per core
+// Pinned processes never share a core or a ready queue, so the runs are independent and can go on separate workers
+typedef struct {
+    process* processes; // Copies of the input's processes grouped by core, they point at the same threads
+    int* first; // Index of each core's first process, partitionAmt + 1 entries
+    runContext* runs; // One per core, results are written back in place
+    int partitionAmt;
+    int processAmt; // In the whole workload, processIndex ranges over it
+    int nextPartition; // Next partition to hand out to a worker
+} partitionSet;
+
+
+bool loadWorkload(inputReader* in, arena* a, process** p, int* processAmt, runContext* ctx); // Parses the processes, fills the switch times in ctx
+bool loadProcesses(inputReader* in, arena* a, process** p, int* processAmt, int* threadSwitch, int* processSwitch); // Maps a binary workload or parses text
+bool parseTextWorkload(inputReader* in, arena* a, process** p, int* processAmt, int* threadSwitch, int* processSwitch);
+thread* createThreadList(inputReader* in, arena* a, int pIndex, int pNum, int tAmt, int priority);
+cpuBurst* createBurstList(inputReader* in, arena* a, int burstAmt, int tNum);
+bool readBursts(inputReader* in, cpuBurst* bList, int bAmt, int tNum); // Fills an already allocated list of bursts
+bool validateLineEnding(inputReader* in);
+
+/* Input Functions */
+inputReader* openInput(char* path); // Maps path, or reads stdin in blocks if path is NULL
+bool refillInput(inputReader* in); // Reads the next block, returns false at end of input
+int peekInput(inputReader* in); // Returns the next character without consuming it, EOF at end of input
+bool readInt(inputReader* in, int* out); // Skips whitespace and reads one integer like scanf(" %d")
+bool readLine(inputReader* in, int* vals, int amt); // Reads amt integers then validates the line ending
+int readLineUpTo(inputReader* in, int* vals, int minAmt, int maxAmt); // Reads minAmt to maxAmt integers from one line, returns how many or -1
+bool readRawLine(inputReader* in, char* line, int cap); // Copies one line without its newline, false at end of input
+void closeInput(inputReader* in);
+
+/* Binary Workload Functions */
+bool isBinaryWorkload(inputReader* in);
+bool mapBinaryWorkload(inputReader* in, process** p, int* processAmt, int* threadSwitch, int* processSwitch); // Points p into the mapped file
+bool tableFits(long long offset, long long count, size_t size, long long limit); // Bounds check of a table read from a file
+bool writeBinaryWorkload(char* path, process* p, int processAmt, int threadSwitch, int processSwitch);
+
+/* Simulation Functions */
+void runSimulation(runContext* ctx, heap* h, core* cores, arrivalStream* stream, int processAmt); // Runs until every thread terminates, fills ctx's results
+void runFcfsSilent(runContext* ctx, heap* h, core* cores, arrivalStream* stream, int processAmt); // runSimulation's specialized loops
+void runFcfsTraced(runContext* ctx, heap* h, core* cores, arrivalStream* stream, int processAmt);
+void runRoundRobinSilent(runContext* ctx, heap* h, core* cores, arrivalStream* stream, int processAmt);
+void runRoundRobinTraced(runContext* ctx, heap* h, core* cores, arrivalStream* stream, int processAmt);
+void runPolicySilent(runContext* ctx, heap* h, core* cores, arrivalStream* stream, int processAmt);
+void runPolicyTraced(runContext* ctx, heap* h, core* cores, arrivalStream* stream, int processAmt);
+SIM_INLINE void simulate(runContext* ctx, heap* h, core* cores, arrivalStream* stream, int processAmt, loopKind kind, bool traced); // The loop every variant is built from
+SIM_INLINE int consumeTime(runContext* ctx, node* n, bool* emptyFlag, loopKind kind);
+int nextEventTime(heap* h, arrivalStream* stream); // Earliest event in the heap or the input, INT_MAX if none
+bool soleCore(runContext* ctx, core* cores, int c); // No core other than c is running
+SIM_INLINE int parseNextEvent(runContext* ctx, heap* h, core* cores, loopKind kind, bool traced); // Returns the core the event's thread was queued on
 
 /* Process/Thread Helper Functions */
 int getTotalIOTime(thread* t);
 int getTotalServiceTime(thread* t);
 int getTurnaroundTime(thread* t);
-float getAverageTurnaroundTime(process** processes, int processAmt);
-thread* createEmptyThread();
-void printProcesses(process** processes, int processAmt);
-void printThreads(thread** threads, int threadAmt);
+void sumBurstTimes(thread* t); // Fills serviceTime and ioTime from the thread's bursts
+void initializeThread(thread* t);
+void printProcesses(process* processes, int processAmt);
+void printThreads(thread* threads, int threadAmt);
 void printThread(thread* t);
-void freeProcesses(process*** processes, int processAmt); // Frees a list of processes
-void freeThreads( thread** threads, int threadAmt);
-void freeBursts(cpuBurst** bursts, int burstAmt);
+process* cloneProcesses(arena* a, process* p, int processAmt); // Copies the threads reset, the bursts are shared
+void resetProcesses(process* p, int processAmt); // Restores threads to their state before a run
+void resetThread(thread* t); // Back to NEW at the start of its first burst
+
+/* Sweep Functions */
+int parseSweepRange(char* arg, int* range); // Parses param=lo..hi[:step] into range, returns the sweepParam or -1
+runContext* buildSweepRuns(runContext* base, int ranges[SWEEP_PARAMS][3], bool* swept, int* runAmt); // One run per combination
+void* sweepWorker(void* arg);
+bool runSweep(sweep* s, int workerAmt);
+void printSweepResults(sweep* s);
+
+/* Partition Functions */
+int* assignPartitions(process* p, int processAmt, int coreAmt); // Pins every process to a core, balancing CPU time
+bool runPartitions(runContext* ctx, process* p, int processAmt, core* cores, int workerAmt); // Simulates each core on its own, then combines the results
+void* partitionWorker(void* arg);
+
+/* Streaming Functions */
+arrivalStream* openArrivalStream(inputReader* in, int* threadSwitch, int* processSwitch); // Reads the first line and the first thread
+thread* readStreamThread(arrivalStream* s); // Reads the next thread, NULL at end of input or on error
+void feedArrivals(arrivalStream* s, heap* h, int time); // Adds every thread arriving at or before time to the event queue
+void releaseStreamThread(arrivalStream* s, thread* t); // Frees a terminated thread
+void closeArrivalStream(arrivalStream* s);
+
+/* Metrics Functions */
+void initializeMetrics(runMetrics* m, int processAmt);
+void recordArrival(runMetrics* m, thread* t); // Arrivals must be recorded in time order
+void recordFirstRun(runMetrics* m, thread* t, int time);
+void recordTermination(runMetrics* m, thread* t);
+void finishMetrics(runContext* ctx); // Fills ctx's averages and percentiles and frees the per-process aggregates
+void mergeMetrics(runMetrics* into, runMetrics* from); // Adds the sums and sketch of a run over a disjoint set of processes
+void addSketch(quantileSketch* q, int val);
+int sketchQuantile(quantileSketch* q, double fraction); // Smallest value with at least fraction of the values at or below it, 0 if empty
+
+/* Replay Functions */
+bool loadReplay(inputReader* in, arena* a, process** p, int* processAmt, long long unit); // Rebuilds a workload from a scheduler log in one pass
+bool parseSchedLine(char* line, schedEvent* ev); // False if the line isn't a scheduler event
+bool parseSchedTask(char* text, char* commKey, char* pidKey, char* comm, int* pid); // Reads comm=X pid=N, or X:N in perf's short form
+void replayEvent(replayLog* r, schedEvent* ev);
+replayThread* replayThreadFor(replayLog* r, int pid, char* comm, state s); // The live thread with pid, created in state s if there is none
+void endReplayBurst(replayThread* rt, long long ioTime); // Ends the burst in progress with ioTime of I/O after it
+void finishReplayThread(replayLog* r, int pid); // Moves the thread into the finished threads with its final burst
+int replayGroupFor(replayLog* r, char* comm);
+unsigned int hashComm(char* comm);
+void buildReplayProcesses(replayLog* r, process** p, int* processAmt); // Groups the finished threads into processes, numbered by arrival
+int compareReplayThreads(const void* a, const void* b);
+
+/* Device Functions */
+ioDevice* initializeDevice(int channelAmt, ioSchedule schedule);
+bool requestIo(ioDevice* d, thread* t, int currBurst, int ioTime, int time); // Takes a free channel, or queues the request and returns false
+void finishIo(ioDevice* d, heap* h, int time); // Frees a channel, starting the next queued request on it if there is one
+void countWaiting(ioDevice* d, int time, int change); // Adds the queue depth since its last change to the time-weighted sum
+void finishDevice(runContext* ctx); // Fills ctx's device statistics and frees the device
+
+/* Checkpoint Functions */
+checkpointer* openCheckpoints(char* path, long long interval, process* p, int processAmt);
+void takeCheckpoint(checkpointer* cp, runContext* ctx, heap* h, core* cores, int currentTime); // Fills a buffer and hands it to the writer thread
+void* checkpointWriter(void* arg);
+bool resumeCheckpoint(checkpointer* cp, runContext* ctx, heap* h, core* cores); // Restores the run from path if it exists, false if it can't be used
+bool closeCheckpoints(checkpointer* cp); // Waits for the last write, returns false if any snapshot failed
+unsigned long long checksumBytes(char* data, size_t len);
+char* putData(char* p, void* src, size_t len); // Returns the end of what was written
+bool getData(char** p, char* end, void* dst, size_t len); // Copies len bytes and advances p, false if fewer are left
+
+/* Trace Functions */
+traceSink* openTrace(FILE* out, bool text); // Binary sinks start with a traceHeader
+void traceTransition(traceSink* s, int time, thread* t, state from, state to);
+void traceThread(traceSink* s, thread* t); // Text sinks only, same output as printThread
+char* traceString(char* p, char* str, size_t len); // Returns the end of what was written, the caller reserves room
+char* traceInt(char* p, int num); // Formats num in decimal without printf
+void reserveTrace(traceSink* s, size_t amt); // Flushes if fewer than amt bytes are left
+void flushTrace(traceSink* s);
+bool closeTrace(traceSink* s); // Flushes, does not close out, false if any write failed
+bool renderTrace(char* path); // Prints a binary trace file as text
+
+/* Results Functions */
+resultsSink* openResults(char* path, bool csv); // Returns NULL if path can't be created
+void recordResult(resultsSink* r, thread* t);
+void recordResults(resultsSink* r, process* p, int processAmt); // Every thread in input order
+void spillResults(resultsSink* r);
+bool closeResults(resultsSink* r); // Writes out what is left, returns false if anything failed to be written
+
+/* Core Functions */
+core* initializeCores(runContext* ctx);
+SIM_INLINE int pickCore(runContext* ctx, core* cores, thread* t, loopKind kind); // Chooses the core a newly ready thread is queued on
+SIM_INLINE int findVictim(runContext* ctx, core* cores, int c, loopKind kind); // Core with the longest ready queue for c to steal from, -1 if none
+SIM_INLINE void dispatchCore(runContext* ctx, core* cores, int c, int time, loopKind kind, bool traced); // Starts the next slice on core c, or idles it
+SIM_INLINE void preemptCore(runContext* ctx, core* cores, int c, int time, loopKind kind, bool traced); // Switches core c to the front of its ready queue if that has less CPU time left
+void freeCores(runContext* ctx, core* cores);
+
+/* Policy Functions */
+bool setPolicy(runContext* ctx, policyType type);
+SIM_INLINE void pushReady(runContext* ctx, void* rq, thread* t, int currBurst, loopKind kind); // Ready queue calls, direct for FIFO loops and through the policy otherwise
+SIM_INLINE node popReady(runContext* ctx, void* rq, loopKind kind);
+SIM_INLINE int readySize(runContext* ctx, void* rq, loopKind kind);
+bool parseLevels(char* arg, runContext* ctx); // Parses a comma separated list of MLFQ quanta
+void* createFifoQueue(void);
+void pushFifoQueue(void* rq, thread* t, int currBurst);
+node popFifoQueue(void* rq);
+int fifoQueueSize(void* rq);
+void freeFifoQueue(void* rq);
+int fifoQuantum(runContext* ctx, thread* t);
+void* createReadyHeap(void); // SJF, SRTF, and priority keep their ready threads in a heap
+void pushShortest(void* rq, thread* t, int currBurst); // Keyed by the CPU time left in the thread's burst
+void pushPriority(void* rq, thread* t, int currBurst); // Keyed by the thread's priority
+void pushReadyHeap(heap* h, int key, thread* t, int currBurst); // Equal keys pop in the order they were pushed
+node popReadyHeap(void* rq);
+int readyHeapSize(void* rq);
+int readyHeapMinKey(heap* h);
+void freeReadyHeap(void* rq);
+int wholeBurst(runContext* ctx, thread* t);
+void* createMlfqQueue(void);
+void pushMlfqQueue(void* rq, thread* t, int currBurst);
+node popMlfqQueue(void* rq);
+int mlfqQueueSize(void* rq);
+void freeMlfqQueue(void* rq);
+int mlfqQuantum(runContext* ctx, thread* t);
+void mlfqExpire(runContext* ctx, thread* t); // Moves t down a level
+
+/* Arena Functions */
+arena* initializeArena();
+void* arenaAlloc(arena* a, size_t size); // Carves size bytes out of the arena, never freed individually
+void freeArena(arena* a); // Frees every process, thread, and burst at once
 
 /* Heap Functions */
-heap* heapFromProcesses(process** pList, int pNum);
+heap* initializeHeap(int capacity, queueType type);
+heap* heapFromProcesses(process* pList, int pNum, queueType type);
 void insertItem(heap* h, int key, void* data, int currBurst);
-node* removeMin(heap* h); // Removes and returns top node
+void insertArrival(heap* h, thread* t, unsigned int arrivalNo); // Arrivals sort by input order, before other events at the same time
+void insertOrdered(heap* h, unsigned long long order, node n); // Inserts into the wheel or heap
+node removeMin(heap* h); // Removes and returns top node by value
+void insertHeap(heap* h, unsigned long long order, node n); // Inserts into the heap array only
+node removeHeapMin(heap* h); // Removes from the heap array only
+void growHeap(heap* h); // Doubles the capacity of the heap, exits if out of memory
+unsigned int renumberSeqs(heap* h, unsigned int mask, unsigned int match); // Compacts the tie-break seqs before a counter wraps
+int compareKeyRefs(const void* a, const void* b);
 int getParentIndex(int index);
-int getLeftIndex(int index);
-int getRightIndex(int index);
+int getChildIndex(int index); // Index of the first of HEAP_ARITY children
 void upheap(heap* h, int index); // Restores heap-order after insertion MUST BE CALLED IN INSERT
 void downheap(heap* h, int i); // Restores heap-order after removal MUST BE CALLED IN REMOVE
 
 int minKey(heap* h); // Gets the arrival time of the top node
 node* minElement(heap* h); // Gets a whole thread from the top node
 bool isEmpty(heap* h);
-void swapNodes(node** n1, node** n2); // Swaps two nodes, double pointers so the values can be carried out of the function
-void incrementAllKeys(heap* h, int amt);
 
 void printHeap(heap* h);
 void freeHeap(heap* h);
 
+/* Timing Wheel Functions */
+timingWheel* initializeWheel();
+void insertWheel(timingWheel* w, unsigned long long order, node n);
+node removeWheelMin(timingWheel* w);
+int findWheelMin(timingWheel* w); // Returns the slot of the earliest event in the wheel
+unsigned long long wheelMinOrder(timingWheel* w);
+void advanceWheel(heap* h, int time); // Moves the wheel's base up to time and pulls newly covered events out of the heap
+void freeWheel(timingWheel* w);
+
 /* Ready Queue Functions */
-heap* initializeReadyQueue();
-void pushReadyQueue(heap* rq, void* data, int currBurst);
-node* popReadyQueue(heap* rq);
+readyQueue* initializeReadyQueue();
+void pushReadyQueue(readyQueue* rq, void* data, int currBurst);
+node popReadyQueue(readyQueue* rq); // Removes and returns the front node by value
+bool isReadyQueueEmpty(readyQueue* rq);
+void growReadyQueue(readyQueue* rq); // Doubles the capacity of the ring buffer
+void freeReadyQueue(readyQueue* rq);
 
 /* Other Functions */
 int min( int n1, int n2 );
 int max( int n1, int n2 );
-void stateSwitch(thread* t, state s, int nextAvailTime);
+SIM_INLINE void stateSwitch(runContext* ctx, thread* t, state s, int nextAvailTime, bool traced); // traced is false when ctx has no trace sinks
+double getTime(); // Monotonic seconds
+void printBenchmark(double* phaseTimes, long long eventAmt);
+#ifdef SIM_STATS
+bool writeStats(char* path, double* phaseTimes, runContext* ctx); // Writes the counters and phase times as JSON
+#endif
 
 #endif /* SIMCPU */
\ No newline at end of file
@@ -0,0 +1,59 @@
+// Public interface for running simulations from other programs
+// Link against libsimcpu.a with -pthread
+#ifndef SIMCPU_API
+#define SIMCPU_API
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#define MLFQ_MAX_LEVELS 16
+
+typedef enum {
+    POLICY_FIFO, // FCFS, or round robin when a quantum is set
+    POLICY_SJF, // Shortest next CPU burst first, non-preemptive
+    POLICY_SRTF, // Shortest remaining CPU burst first, preemptive
+    POLICY_PRIORITY, // Lowest process priority first, non-preemptive
+    POLICY_MLFQ // Multi-level feedback queue
+} policyType;
+
+typedef struct workload workload; // A parsed input file, can be simulated any number of times
+
+typedef struct {
+    policyType policy;
+    int quantum; // Round robin time quantum for POLICY_FIFO, 0 for FCFS
+    int levelAmt; // MLFQ levels
+    int levelQuanta[MLFQ_MAX_LEVELS]; // Quantum of each MLFQ level, 0 runs bursts to completion
+    int cores; // Number of simulated CPUs
+    bool wheel; // Use the timing wheel event queue instead of the heap
+    bool verbose; // Print every state transition to stdout
+    FILE* trace; // Binary trace of every state transition is written here when not NULL
+    bool fastForward; // Skip the event loop when a core has nothing to contend with, results are the same either way
+    int threadSwitch; // Thread switch time, -1 to use the workload's
+    int processSwitch; // Process switch time, -1 to use the workload's
+    int ioChannels; // I/O channels shared by every thread, 0 lets every blocked thread do its I/O at once
+    bool elevator; // Serve queued I/O in elevator order by process number instead of first come first serve
+} sim_config;
+
+typedef struct {
+    int totalTime;
+    long long events; // Events delivered plus slices finished
+    int busyTime; // Time spent running threads, summed over every core
+    float avgTurnaround; // Per process
+    float avgWaiting; // Per thread, time spent ready, switching or queued for I/O
+    float avgResponse; // Per thread, time from arrival to first running
+    int turnaroundP50; // Thread turnaround percentiles, within about 3% of the exact value
+    int turnaroundP95;
+    int turnaroundP99;
+    float cpuUtilization; // Percent of totalTime * cores spent running threads
+    float ioUtilization; // Percent of totalTime * ioChannels spent doing I/O, 0 without ioChannels
+    float avgIoQueue; // Requests waiting for an I/O channel, averaged over the run
+    int maxIoQueue;
+} sim_result;
+
+void sim_init_config(sim_config* cfg); // FCFS on one core with the workload's switch times
+workload* sim_load(char* path); // Reads a text or binary workload, NULL reads a text workload from stdin
+bool sim_run(workload* w, sim_config* cfg, sim_result* res); // Resets w if it was run before, false if cfg is invalid or the trace couldn't be written
+void sim_reset(workload* w); // Restores every thread to its state before the first run
+void sim_free(workload* w);
+
+#endif /* SIMCPU_API */